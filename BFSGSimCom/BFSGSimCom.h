@@ -5,7 +5,8 @@
  */
 #pragma once
 
-#include "teamspeak\public_definitions.h"
+#include "teamspeak/public_definitions.h"
+#include "plugin_definitions.h"
 
 #ifdef WIN32
 #define PLUGINS_EXPORTDLL __declspec(dllexport)
@@ -43,7 +44,7 @@ extern "C" {
     PLUGINS_EXPORTDLL void ts3plugin_configure(void* handle, void* qParentWidget);
     PLUGINS_EXPORTDLL void ts3plugin_registerPluginID(const char* id);
     PLUGINS_EXPORTDLL const char* ts3plugin_commandKeyword();
-    //PLUGINS_EXPORTDLL int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* command);
+    PLUGINS_EXPORTDLL int ts3plugin_processCommand(uint64 serverConnectionHandlerID, const char* command);
     PLUGINS_EXPORTDLL void ts3plugin_currentServerConnectionChanged(uint64 serverConnectionHandlerID);
     PLUGINS_EXPORTDLL const char* ts3plugin_infoTitle();
     PLUGINS_EXPORTDLL void ts3plugin_infoData(uint64 serverConnectionHandlerID, uint64 id, enum PluginItemType type, char** data);
@@ -0,0 +1,456 @@
+// Checks the in-memory channel list and lookups against the SQL they replaced, on made up channel trees. It
+// isn't part of the plugin.
+//
+// Build it on Linux, from this directory, with:
+//
+//     g++ -std=c++14 -O2 -I.. -I../SQLite3 -I"../~pluginsdk/include" -I. -o channelcheck ChannelCheck.cpp
+//         TS3Channels.cpp ChannelIndex.cpp TuningTable.cpp GeoIndex.cpp InRangeTracker.cpp ChannelTables.cpp
+//         StringArena.cpp ICAOData.cpp ../SQLiteCpp/*.cpp -lsqlite3 -pthread
+//
+// and run it as:
+//
+//     channelcheck [-t trees] [-c channels] [-q lookups] [-e changes] [-s seed]
+//
+// Each tree is built the way TS3 describes one - every channel's order is the ID of the sibling before it -
+// with a few channels whose order points nowhere, which TS3 doesn't show. Channels are named for a handful of
+// made up airports held in a scratch ICAO database, or carry a frequency and position of their own, or
+// nothing at all, and the frequencies are drawn from a short list so that plenty of them are shared.
+//
+// For every tree, getChannelList is compared with the original recursive query from the root and from
+// channels throughout the tree, and getChannelID with the original lookup query, over random frequencies,
+// current channels, roots, positions, 8.33 capability and range policies. The tree is then changed a channel
+// at a time, as TS3 changes it while connected - channels renamed, moved and deleted - and checked again, so
+// that what's kept up to date as channels change is checked as well as what's built in one go. Anything that
+// differs is printed, and the exit code is the number of trees that had differences (up to 100).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SQLiteCpp/Database.h>
+
+#include "BFSGSimCom.h"
+#include "TS3Channels.h"
+
+using namespace std;
+
+char pluginPath[PATH_BUFSIZE] = "";
+
+static const int AIRPORTS = 10;
+static const char* aTypes[] = { "GND", "TWR", "APP" };
+static const char* aFrequencies[] = { "118.500", "118.505", "121.900", "121.905", "122.800", "124.225", "131.550" };
+static const uint32_t aQueried[] = { 118500, 118505, 121900, 121905, 122800, 124225, 131550, 123450 };
+
+// Airports K000 upwards, each with ground, tower and approach on the first few frequencies, somewhere
+// around the area the trees are placed in.
+static bool makeIcaoData(mt19937& rng)
+{
+    char dir[] = "/tmp/channelcheck-XXXXXX";
+    if (mkdtemp(dir) == NULL) return false;
+
+    snprintf(pluginPath, PATH_BUFSIZE, "%s/", dir);
+    string plugin = string(pluginPath) + "BFSGSimCom_plugin";
+    if (mkdir(plugin.c_str(), 0700) != 0) return false;
+
+    uniform_real_distribution<double> lat(50.0, 53.0);
+    uniform_real_distribution<double> lon(-3.0, 1.0);
+
+    SQLite::Database db(plugin + "/BFSGSimCom.db", SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE);
+    db.exec("create table airports(id bigint, ident text, name text, latitude double, longitude double)");
+    db.exec("create table airportfrequencies(id bigint, airport_ref bigint, type text, frequency int)");
+
+    for (int a = 0; a < AIRPORTS; a++)
+    {
+        stringstream ssAirport;
+        ssAirport << "insert into airports values(" << a << ", 'K" << setw(3) << setfill('0') << a << "', 'Airport " << a << "', " << lat(rng) << ", " << lon(rng) << ")";
+        db.exec(ssAirport.str());
+
+        for (int t = 0; t < 3; t++)
+        {
+            stringstream ssFrequency;
+            ssFrequency << "insert into airportfrequencies values(" << a * 3 + t << ", " << a << ", '" << aTypes[t] << "', " << aQueried[(a + t) % 5] << ")";
+            db.exec(ssFrequency.str());
+        }
+    }
+
+    return true;
+}
+
+// What a channel was made with, so that it can be changed the way TS3 would change it.
+struct Made
+{
+    uint64 parent;
+    uint64 order;
+    string name;
+    string description;
+};
+
+struct Tree
+{
+    vector<uint64> ids;
+    unordered_map<uint64, Made> made;
+};
+
+static void nameChannel(mt19937& rng, uint64 channelID, Made& made)
+{
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    uniform_real_distribution<double> lat(50.0, 53.0);
+    uniform_real_distribution<double> lon(-3.0, 1.0);
+
+    stringstream ssName;
+    stringstream ssDesc;
+    double kind = uniform(rng);
+
+    if (kind < 0.3)
+    {
+        ssName << "K" << setw(3) << setfill('0') << rng() % AIRPORTS << "_" << aTypes[rng() % 3];
+    }
+    else if (kind < 0.8)
+    {
+        ssName << "Channel " << channelID;
+        ssDesc << aFrequencies[rng() % 7];
+        if (uniform(rng) < 0.7)
+        {
+            double la = lat(rng);
+            double lo = lon(rng);
+            ssDesc << fixed << setprecision(4) << " " << (la < 0 ? 'S' : 'N') << fabs(la) << " " << (lo < 0 ? 'W' : 'E') << fabs(lo);
+        }
+    }
+    else
+    {
+        ssName << "Room " << channelID;
+    }
+
+    made.name = ssName.str();
+    made.description = ssDesc.str();
+}
+
+// Fills the channels with a random tree.
+static Tree makeTree(TS3Channels& channels, mt19937& rng, int count, int tree)
+{
+    Tree retValue;
+    vector<uint64> parents = { TS3Channels::CHANNEL_ROOT };
+    unordered_map<uint64, uint64> lastChild;
+
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    stringstream ssSource;
+    ssSource << "tree-" << tree;
+    channels.beginRebuild(ssSource.str());
+
+    uint64 next = 1 + rng() % 1000;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint64 channelID = next;
+        next += 1 + rng() % 5;
+
+        Made& made = retValue.made[channelID];
+
+        // Mostly under recent channels, so the trees are deep as well as wide.
+        made.parent = parents[parents.size() - 1 - rng() % min<size_t>(parents.size(), 8)];
+        if (uniform(rng) < 0.1) made.parent = parents[rng() % parents.size()];
+
+        made.order = lastChild.count(made.parent) ? lastChild[made.parent] : 0;
+        if (uniform(rng) < 0.03) made.order = 999999;
+        else lastChild[made.parent] = channelID;
+
+        nameChannel(rng, channelID, made);
+
+        channels.queueChannel(made.name, "", made.description, channelID, made.parent, made.order, NULL);
+
+        retValue.ids.push_back(channelID);
+        parents.push_back(channelID);
+    }
+
+    channels.commitRebuild();
+
+    return retValue;
+}
+
+// The channel that comes after the given one among its siblings, if any does.
+static uint64 followerOf(const Tree& tree, uint64 channelID)
+{
+    const Made& made = tree.made.at(channelID);
+
+    for (const auto& other : tree.made)
+    {
+        if (other.second.parent == made.parent && other.second.order == channelID) return other.first;
+    }
+
+    return TS3Channels::CHANNEL_ID_NOT_FOUND;
+}
+
+// Takes a channel out of its siblings' order, as TS3 does when one's moved or deleted - whatever came after
+// it now comes after whatever came before it.
+static void unchain(TS3Channels& channels, Tree& tree, uint64 channelID, chrono::steady_clock::duration& spent)
+{
+    uint64 follower = followerOf(tree, channelID);
+    if (follower == TS3Channels::CHANNEL_ID_NOT_FOUND) return;
+
+    Made& made = tree.made[follower];
+    made.order = tree.made[channelID].order;
+
+    string commentary;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    channels.addOrUpdateChannel(commentary, made.name, "", made.description, follower, made.parent, made.order);
+    spent += chrono::steady_clock::now() - started;
+}
+
+static bool isUnder(const Tree& tree, uint64 channelID, uint64 ancestor)
+{
+    for (int depth = 0; depth < 1024 && channelID != TS3Channels::CHANNEL_ROOT; depth++)
+    {
+        if (channelID == ancestor) return true;
+
+        auto made = tree.made.find(channelID);
+        if (made == tree.made.end()) return false;
+        channelID = made->second.parent;
+    }
+
+    return channelID == ancestor;
+}
+
+// Changes channels one at a time, the way they're changed while connected - a third of them given new
+// names and descriptions, a third moved somewhere else in the tree and a third deleted, along with anything
+// under them. Returns the time TS3Channels took over the changes, all told.
+static chrono::steady_clock::duration editTree(TS3Channels& channels, Tree& tree, mt19937& rng, int edits)
+{
+    chrono::steady_clock::duration retValue(0);
+
+    for (int i = 0; i < edits && tree.ids.size() > 1; i++)
+    {
+        uint64 channelID = tree.ids[rng() % tree.ids.size()];
+        Made& made = tree.made[channelID];
+        string commentary;
+        chrono::steady_clock::time_point started;
+
+        switch (rng() % 3)
+        {
+        case 0:
+            nameChannel(rng, channelID, made);
+            started = chrono::steady_clock::now();
+            channels.addOrUpdateChannel(commentary, made.name, "", made.description, channelID, made.parent, made.order);
+            retValue += chrono::steady_clock::now() - started;
+            break;
+
+        case 1:
+        {
+            uint64 parent = (rng() % 5 == 0) ? TS3Channels::CHANNEL_ROOT : tree.ids[rng() % tree.ids.size()];
+            if (isUnder(tree, parent, channelID)) break;
+
+            // Out of the order it was in, it doesn't follow anything...
+            unchain(channels, tree, channelID, retValue);
+            made.order = TS3Channels::CHANNEL_ID_NOT_FOUND;
+
+            // ...until it goes to the end of its new siblings, after the one nothing else follows.
+            unordered_set<uint64> followed;
+            for (const auto& other : tree.made)
+            {
+                if (other.second.parent == parent) followed.insert(other.second.order);
+            }
+
+            uint64 last = 0;
+            for (const auto& other : tree.made)
+            {
+                if (other.first != channelID && other.second.parent == parent && followed.count(other.first) == 0)
+                    last = other.first;
+            }
+
+            made.parent = parent;
+            made.order = last;
+            started = chrono::steady_clock::now();
+            channels.addOrUpdateChannel(commentary, made.name, "", made.description, channelID, made.parent, made.order);
+            retValue += chrono::steady_clock::now() - started;
+            break;
+        }
+
+        default:
+            unchain(channels, tree, channelID, retValue);
+            started = chrono::steady_clock::now();
+            channels.deleteChannel(channelID);
+            retValue += chrono::steady_clock::now() - started;
+
+            vector<uint64> kept;
+            for (uint64 ch : tree.ids)
+            {
+                if (!isUnder(tree, ch, channelID)) kept.push_back(ch);
+            }
+
+            for (uint64 ch : tree.ids)
+            {
+                if (isUnder(tree, ch, channelID)) tree.made.erase(ch);
+            }
+
+            tree.ids = kept;
+            break;
+        }
+    }
+
+    return retValue;
+}
+
+static string describe(const vector<TS3Channels::ChannelInfo>& list)
+{
+    stringstream ss;
+    for (size_t i = 0; i < list.size() && i < 12; i++) ss << " " << list[i].channelID << "@" << list[i].depth;
+    if (list.size() > 12) ss << " ...";
+    return ss.str();
+}
+
+static int checkLists(TS3Channels& channels, const vector<uint64>& ids, mt19937& rng)
+{
+    int differences = 0;
+    vector<uint64> roots = { TS3Channels::CHANNEL_ROOT };
+    for (int i = 0; i < 20; i++) roots.push_back(ids[rng() % ids.size()]);
+
+    for (uint64 root : roots)
+    {
+        vector<TS3Channels::ChannelInfo> walked = channels.getChannelList(root);
+        vector<TS3Channels::ChannelInfo> queried = channels.getChannelListFromSql(root);
+
+        bool blSame = (walked.size() == queried.size());
+        for (size_t i = 0; blSame && i < walked.size(); i++)
+        {
+            blSame = walked[i].channelID == queried[i].channelID && walked[i].depth == queried[i].depth && walked[i].name == queried[i].name;
+        }
+
+        if (!blSame)
+        {
+            cout << "  list from " << root << ": walked" << describe(walked) << " (" << walked.size() << ")" << endl;
+            cout << "  list from " << root << ": query " << describe(queried) << " (" << queried.size() << ")" << endl;
+            differences++;
+        }
+    }
+
+    return differences;
+}
+
+// How many lookups found a channel, and how many of those were out of range, so it's clear the checks
+// weren't all of nothing.
+static uint64 found = 0;
+static uint64 outOfRange = 0;
+
+static int checkLookups(TS3Channels& channels, const vector<uint64>& ids, mt19937& rng, int lookups)
+{
+    static const char* aPolicies[] = { "ignored", "orders", "limits" };
+
+    int differences = 0;
+    uniform_real_distribution<double> lat(49.5, 53.5);
+    uniform_real_distribution<double> lon(-3.5, 1.5);
+
+    for (int i = 0; i < lookups; i++)
+    {
+        uint32_t frequency = aQueried[rng() % 8];
+        uint64 current = (rng() % 10 == 0) ? TS3Channels::CHANNEL_ROOT : ids[rng() % ids.size()];
+
+        // Most lookups are under a few roots, as they are in use, so that tuning tables are built for them
+        // and looked up in. A lookup from the root itself takes the table's order as it is.
+        uint64 root = (rng() % 3 == 0) ? TS3Channels::CHANNEL_ROOT : ids[rng() % ((rng() % 2 == 0) ? (std::min)(ids.size(), size_t(3)) : ids.size())];
+        if (rng() % 4 == 0) current = root;
+
+        bool bl833 = (rng() % 2 == 0);
+        int policy = rng() % 3;
+        double aLat = lat(rng);
+        double aLon = lon(rng);
+
+        TS3Channels::StationInfo indexed = channels.getChannelID(frequency, current, root, policy > 0, policy > 1, bl833, aLat, aLon);
+        TS3Channels::StationInfo queried = channels.getChannelIDFromSql(frequency, current, root, policy > 0, policy > 1, bl833, aLat, aLon);
+
+        if (queried.ch < TS3Channels::CHANNEL_NOT_CHILD_OF_ROOT)
+        {
+            found++;
+            if (!queried.in_range) outOfRange++;
+        }
+
+        if (indexed.ch != queried.ch || (policy > 0 && indexed.ch < TS3Channels::CHANNEL_NOT_CHILD_OF_ROOT && indexed.in_range != queried.in_range))
+        {
+            cout << "  lookup " << frequency << (bl833 ? " 8.33" : "") << " from " << current << " under " << root << " range " << aPolicies[policy]
+                << " at " << aLat << "," << aLon << ": index " << indexed.ch << " (" << indexed.range << "nm), query " << queried.ch << " (" << queried.range << "nm)" << endl;
+            differences++;
+        }
+    }
+
+    return differences;
+}
+
+int main(int argc, char* argv[])
+{
+    int trees = 50;
+    int count = 200;
+    int lookups = 2000;
+    int edits = 50;
+    unsigned seed = random_device()();
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string arg = argv[i];
+
+        if (arg == "-t") trees = atoi(argv[i + 1]);
+        else if (arg == "-c") count = atoi(argv[i + 1]);
+        else if (arg == "-q") lookups = atoi(argv[i + 1]);
+        else if (arg == "-e") edits = atoi(argv[i + 1]);
+        else if (arg == "-s") seed = unsigned(strtoul(argv[i + 1], NULL, 10));
+        else
+        {
+            cerr << "usage: channelcheck [-t trees] [-c channels] [-q lookups] [-e changes] [-s seed]" << endl;
+            return 100;
+        }
+    }
+
+    cout << "seed " << seed << endl;
+    mt19937 rng(seed);
+
+    if (!makeIcaoData(rng))
+    {
+        cerr << "can't make the ICAO data" << endl;
+        return 100;
+    }
+
+    int failed = 0;
+    chrono::steady_clock::duration editing(0);
+
+    for (int t = 0; t < trees; t++)
+    {
+        TS3Channels channels;
+        Tree tree = makeTree(channels, rng, count, t);
+
+        int lists = checkLists(channels, tree.ids, rng);
+        int lookupsDiffering = checkLookups(channels, tree.ids, rng, lookups);
+
+        // Then again, once it's been changed piece by piece.
+        editing += editTree(channels, tree, rng, edits);
+
+        if (!tree.ids.empty())
+        {
+            lists += checkLists(channels, tree.ids, rng);
+            lookupsDiffering += checkLookups(channels, tree.ids, rng, lookups);
+        }
+
+        if (lists + lookupsDiffering > 0)
+        {
+            cout << "tree " << t << ": " << lists << " lists and " << lookupsDiffering << " lookups differ" << endl;
+            failed++;
+        }
+    }
+
+    cout << trees << " trees of " << count << " channels, " << failed << " with differences" << endl;
+    cout << uint64(trees) * lookups * 2 << " lookups, " << found << " finding a channel, " << outOfRange << " of them out of range" << endl;
+    if (edits > 0) cout << trees * edits << " changes, " << chrono::duration_cast<chrono::microseconds>(editing).count() / (trees * edits) << "us each" << endl;
+
+    return min(failed, 100);
+}
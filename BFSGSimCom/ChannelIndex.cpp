@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "ChannelIndex.h"
+
+using namespace std;
+
+ChannelIndex::Channel::Channel(uint64 ch)
+{
+    channelID = ch;
+    parent = 0;
+    order = 0;
+    lat = 0.0;
+    lon = 0.0;
+    hasLatLon = false;
+    range = 10800.0;
+    name = "";
+    station = "";
+    fingerprint = 0;
+    header = 0;
+}
+
+const string& ChannelIndex::Channel::getTopic(void) const
+{
+    static const string none;
+    return (text == NULL) ? none : text->topic;
+}
+
+const string& ChannelIndex::Channel::getDescription(void) const
+{
+    static const string none;
+    return (text == NULL) ? none : text->description;
+}
+
+ChannelIndex::ChannelIndex()
+{
+    mVersion = 0;
+    clear();
+}
+
+void ChannelIndex::clear(void)
+{
+    mChannels.clear();
+    mChildren.clear();
+    mFrequencies.clear();
+
+    for (TuningTable& tuning : mTunings)
+        tuning.clear(tuning.getRoot());
+
+    // The root channel is always there, even though TS3 never tells us about it.
+    shared_ptr<Channel> root = make_shared<Channel>(0);
+    root->name = "Root";
+    root->station = "Root Channel";
+
+    addOrUpdate(root);
+}
+
+const ChannelIndex::Channel* ChannelIndex::getChannel(uint64 channelID) const
+{
+    const shared_ptr<const Channel>* ch = mChannels.find(channelID);
+    return (ch == NULL) ? NULL : ch->get();
+}
+
+const vector<uint64>& ChannelIndex::getChannelsOnFrequency(uint32_t frequency, bool freq833) const
+{
+    static const vector<uint64> none;
+
+    const vector<uint64>* channels = mFrequencies.find(frequencyKey(frequency, freq833));
+    return (channels == NULL) ? none : *channels;
+}
+
+const vector<uint64>& ChannelIndex::getChildren(uint64 channelID) const
+{
+    static const vector<uint64> none;
+
+    const vector<uint64>* children = mChildren.find(channelID);
+    return (children == NULL) ? none : *children;
+}
+
+// True if the channel is the root or anywhere beneath it.
+bool ChannelIndex::isUnderRoot(uint64 channel, uint64 root) const
+{
+    const Channel* ch = getChannel(channel);
+
+    for (int depth = 0; ch != NULL && depth < MAX_DEPTH; depth++)
+    {
+        if (ch->channelID == root) return true;
+        if (ch->channelID == 0) break;
+
+        ch = getChannel(ch->parent);
+    }
+
+    return false;
+}
+
+// Works out how far apart two channels are in the tree, through their closest common parent.
+// The distance is the number of steps from one to the other, and removed is how many of those
+// steps are down from the common parent to the second channel.
+bool ChannelIndex::getDistance(uint64 from, uint64 to, int& distance, int& removed) const
+{
+    vector<uint64> fromParents;
+
+    if (getChannel(to) == NULL) return false;
+
+    for (const Channel* ch = getChannel(from); ch != NULL && fromParents.size() < MAX_DEPTH; ch = getChannel(ch->parent))
+    {
+        fromParents.push_back(ch->channelID);
+        if (ch->channelID == 0) break;
+    }
+
+    int depth = 0;
+    for (const Channel* ch = getChannel(to); ch != NULL && depth < MAX_DEPTH; ch = getChannel(ch->parent), depth++)
+    {
+        auto common = find(fromParents.begin(), fromParents.end(), ch->channelID);
+        if (common != fromParents.end())
+        {
+            distance = int(common - fromParents.begin()) + depth;
+            removed = depth;
+            return true;
+        }
+
+        if (ch->channelID == 0) break;
+    }
+
+    return false;
+}
+
+void ChannelIndex::addOrUpdate(shared_ptr<const Channel> channel)
+{
+    const shared_ptr<const Channel>* existing = mChannels.find(channel->channelID);
+
+    bool moved = (existing == NULL) || ((*existing)->parent != channel->parent);
+    bool retuned = (existing == NULL) || ((*existing)->frequencies != channel->frequencies);
+
+    // A channel that's kept its place and its frequencies is only replaced, so the lists it's in aren't touched.
+    if (moved || retuned)
+    {
+        if (existing != NULL) unlink(**existing);
+        mChannels[channel->channelID] = channel;
+        link(*channel);
+    }
+    else
+    {
+        mChannels[channel->channelID] = channel;
+    }
+
+    // Only a channel that has moved takes anything beneath it in or out of a tuning table.
+    for (TuningTable& tuning : mTunings)
+    {
+        if (moved)
+            retune(tuning, channel->channelID);
+        else if (tuning.getPath(channel->channelID) != NULL)
+        {
+            vector<uint64> path = *tuning.getPath(channel->channelID);
+            vector<uint64> keys;
+
+            for (const tuple<uint32_t, bool>& frequency : channel->frequencies)
+                keys.push_back(frequencyKey(get<0>(frequency), get<1>(frequency)));
+
+            tuning.add(channel->channelID, path, keys, channel->hasLatLon, channel->lat, channel->lon);
+        }
+    }
+}
+
+// Removes a channel and everything beneath it, returning the IDs of all the channels removed.
+vector<uint64> ChannelIndex::remove(uint64 channelID)
+{
+    vector<uint64> removed;
+    unordered_set<uint64> seen;
+
+    // The root channel never goes, only what's underneath it.
+    if (channelID == 0)
+    {
+        const vector<uint64>* top = mChildren.find(0);
+        if (top != NULL) removed = *top;
+    }
+    else if (mChannels.find(channelID) != NULL)
+    {
+        removed.push_back(channelID);
+    }
+
+    for (size_t i = 0; i < removed.size(); i++)
+    {
+        if (!seen.insert(removed[i]).second) continue;
+
+        const vector<uint64>* children = mChildren.find(removed[i]);
+        if (children != NULL)
+        {
+            removed.insert(removed.end(), children->begin(), children->end());
+        }
+    }
+
+    removed.assign(seen.begin(), seen.end());
+
+    for (uint64 ch : removed)
+    {
+        const shared_ptr<const Channel>* existing = mChannels.find(ch);
+        if (existing != NULL)
+        {
+            unlink(**existing);
+            mChannels.erase(ch);
+        }
+
+        mChildren.erase(ch);
+
+        for (TuningTable& tuning : mTunings)
+            tuning.remove(ch);
+    }
+
+    return removed;
+}
+
+// Adds the channel to the child list of its parent and the list of channels for each of its frequencies.
+void ChannelIndex::link(const Channel& channel)
+{
+    if (channel.channelID != 0)
+    {
+        mChildren[channel.parent].push_back(channel.channelID);
+    }
+
+    for (const tuple<uint32_t, bool>& frequency : channel.frequencies)
+    {
+        vector<uint64>& channels = mFrequencies[frequencyKey(get<0>(frequency), get<1>(frequency))];
+
+        // The same frequency can be given more than once.
+        if (find(channels.begin(), channels.end(), channel.channelID) == channels.end())
+            channels.push_back(channel.channelID);
+    }
+}
+
+void ChannelIndex::unlink(const Channel& channel)
+{
+    vector<uint64>* siblings = mChildren.edit(channel.parent);
+    if (siblings != NULL)
+    {
+        siblings->erase(std::remove(siblings->begin(), siblings->end(), channel.channelID), siblings->end());
+        if (siblings->empty()) mChildren.erase(channel.parent);
+    }
+
+    for (const tuple<uint32_t, bool>& frequency : channel.frequencies)
+    {
+        uint64 key = frequencyKey(get<0>(frequency), get<1>(frequency));
+        vector<uint64>* channels = mFrequencies.edit(key);
+        if (channels != NULL)
+        {
+            channels->erase(std::remove(channels->begin(), channels->end(), channel.channelID), channels->end());
+            if (channels->empty()) mFrequencies.erase(key);
+        }
+    }
+}
+
+// The tuning table for the root, or NULL if there isn't one.
+const TuningTable* ChannelIndex::getTuning(uint64 root) const
+{
+    for (const TuningTable& tuning : mTunings)
+    {
+        if (tuning.getRoot() == root) return &tuning;
+    }
+
+    return NULL;
+}
+
+// Builds the tuning table for a root, dropping the one asked for longest ago if there are too many. Changes
+// after this keep it up to date.
+void ChannelIndex::addTuning(uint64 root)
+{
+    auto existing = find_if(mTunings.begin(), mTunings.end(), [root](const TuningTable& tuning) { return tuning.getRoot() == root; });
+
+    if (existing != mTunings.end())
+    {
+        rotate(mTunings.begin(), existing, existing + 1);
+        return;
+    }
+
+    if (mTunings.size() >= MAX_TUNINGS) mTunings.pop_back();
+
+    mTunings.insert(mTunings.begin(), TuningTable(root));
+    retune(mTunings.front(), root);
+}
+
+void ChannelIndex::refreshTuning(void)
+{
+    for (TuningTable& tuning : mTunings)
+        tuning.refresh();
+}
+
+// Takes a channel and everything beneath it out of the tuning table.
+void ChannelIndex::untune(TuningTable& tuning, uint64 channelID)
+{
+    vector<uint64> pending = { channelID };
+
+    while (!pending.empty())
+    {
+        uint64 ch = pending.back();
+        pending.pop_back();
+
+        if (tuning.getPath(ch) == NULL) continue;
+        tuning.remove(ch);
+
+        const vector<uint64>* children = mChildren.find(ch);
+        if (children != NULL)
+            pending.insert(pending.end(), children->begin(), children->end());
+    }
+}
+
+// Puts a channel and everything beneath it back into the tuning table, if it's now under the root.
+void ChannelIndex::retune(TuningTable& tuning, uint64 channelID)
+{
+    untune(tuning, channelID);
+
+    const Channel* channel = getChannel(channelID);
+    if (channel == NULL) return;
+
+    vector<uint64> path;
+    if (channelID == tuning.getRoot())
+    {
+        path.push_back(channelID);
+    }
+    else
+    {
+        const vector<uint64>* parentPath = (channelID == 0) ? NULL : tuning.getPath(channel->parent);
+        if (parentPath == NULL) return;
+
+        path = *parentPath;
+        path.push_back(channelID);
+    }
+
+    vector<pair<uint64, vector<uint64>>> pending = { make_pair(channelID, path) };
+
+    while (!pending.empty())
+    {
+        uint64 ch = pending.back().first;
+        path = pending.back().second;
+        pending.pop_back();
+
+        // A channel already in the table has been reached another way - it's a loop.
+        const Channel* node = getChannel(ch);
+        if (node == NULL || tuning.getPath(ch) != NULL || path.size() > MAX_DEPTH) continue;
+
+        vector<uint64> keys;
+        for (const tuple<uint32_t, bool>& frequency : node->frequencies)
+            keys.push_back(frequencyKey(get<0>(frequency), get<1>(frequency)));
+
+        tuning.add(ch, path, keys, node->hasLatLon, node->lat, node->lon);
+
+        const vector<uint64>* children = mChildren.find(ch);
+        if (children == NULL) continue;
+
+        for (uint64 child : *children)
+        {
+            vector<uint64> childPath = path;
+            childPath.push_back(child);
+            pending.push_back(make_pair(child, childPath));
+        }
+    }
+}
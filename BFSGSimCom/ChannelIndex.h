@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+
+#include "CowMap.h"
+#include "TuningTable.h"
+
+using namespace ::std;
+
+// An in-memory index of the parsed TS3 channel tree.
+//
+// Once published by TS3Channels an index is never modified, so any number of threads can read it
+// at once. The writer builds each version by copying the previous one and applying its changes.
+// Channel records are shared between versions rather than copied, and so is every part of the maps
+// holding them that hasn't changed since, so a copy and a change after it only cost a few pointers.
+class ChannelIndex
+{
+public:
+    struct Text
+    {
+        string topic;
+        string description;
+    };
+
+    // Names and station idents point into the shared string arena.
+    struct Channel
+    {
+        uint64 channelID;
+        uint64 parent;
+        uint64 order;
+        double lat;
+        double lon;
+        bool hasLatLon;
+        double range;
+        const char* name;
+        const char* station;
+        vector<tuple<uint32_t, bool>> frequencies;
+        uint64 fingerprint;
+        uint64 header;
+
+        // The raw text isn't needed once a channel is parsed, and isn't kept in compact storage.
+        shared_ptr<const Text> text;
+
+    public:
+        Channel(uint64 ch = 0);
+
+        const string& getTopic(void) const;
+        const string& getDescription(void) const;
+    };
+
+    ChannelIndex();
+
+    uint64 getVersion(void) const { return mVersion; };
+    void setVersion(uint64 version) { mVersion = version; };
+
+    const Channel* getChannel(uint64) const;
+    typedef CowMap<uint64, shared_ptr<const Channel>> Channels;
+
+    const Channels& getChannels(void) const { return mChannels; };
+    const vector<uint64>& getChannelsOnFrequency(uint32_t frequency, bool freq833) const;
+    const vector<uint64>& getChildren(uint64) const;
+
+    bool isUnderRoot(uint64 channel, uint64 root) const;
+    bool getDistance(uint64 from, uint64 to, int& distance, int& removed) const;
+
+    // The tuning tables follow every change to the channels. There's one for each of the last few roots
+    // asked for, and lookups for any other root have to do without.
+    const TuningTable* getTuning(uint64 root) const;
+    void addTuning(uint64 root);
+    void refreshTuning(void);
+
+    void addOrUpdate(shared_ptr<const Channel>);
+    vector<uint64> remove(uint64);
+    void clear(void);
+
+    static uint64 frequencyKey(uint32_t frequency, bool freq833) { return (uint64(frequency) << 1) | (freq833 ? 1 : 0); };
+
+private:
+    // Deepest tree we'll walk - anything deeper has to be a loop.
+    static const int MAX_DEPTH = 1024;
+
+    // Roots rarely change, so only a few tables are kept.
+    static const size_t MAX_TUNINGS = 4;
+
+    uint64 mVersion;
+
+    Channels mChannels;
+    CowMap<uint64, vector<uint64>> mChildren;
+    CowMap<uint64, vector<uint64>> mFrequencies;
+    // Most recently asked for first.
+    vector<TuningTable> mTunings;
+
+    void unlink(const Channel&);
+    void link(const Channel&);
+    void retune(TuningTable&, uint64);
+    void untune(TuningTable&, uint64);
+};
@@ -0,0 +1,104 @@
+#include "ChannelJournal.h"
+
+using namespace std;
+
+ChannelJournal::ChannelJournal(function<void(void)> due, chrono::milliseconds quiet, size_t threshold) :
+    mDue(due),
+    mQuiet(quiet),
+    mThreshold(threshold),
+    mStop(false)
+{
+    mFlusher = thread(&ChannelJournal::run, this);
+}
+
+ChannelJournal::~ChannelJournal()
+{
+    {
+        lock_guard<mutex> lock(mLock);
+        mStop = true;
+    }
+
+    mWake.notify_all();
+    mFlusher.join();
+}
+
+void ChannelJournal::reload(uint64 channel)
+{
+    record(channel, JOURNAL_RELOAD);
+}
+
+void ChannelJournal::remove(uint64 channel)
+{
+    record(channel, JOURNAL_DELETE);
+}
+
+// Only the last thing that happened to a channel matters - it's either there to be reloaded, or it's gone.
+void ChannelJournal::record(uint64 channel, Action action)
+{
+    {
+        lock_guard<mutex> lock(mLock);
+
+        if (mPending.find(channel) == mPending.end()) mOrder.push_back(channel);
+        mPending[channel] = action;
+        mLastEvent = chrono::steady_clock::now();
+    }
+
+    mWake.notify_all();
+}
+
+// Must be called with the lock held.
+bool ChannelJournal::due(chrono::steady_clock::time_point now)
+{
+    return !mPending.empty() && (mPending.size() >= mThreshold || now >= mLastEvent + mQuiet);
+}
+
+bool ChannelJournal::isDue(void)
+{
+    lock_guard<mutex> lock(mLock);
+
+    return due(chrono::steady_clock::now());
+}
+
+// Hands over everything waiting, in the order the channels were first seen.
+vector<ChannelJournal::Entry> ChannelJournal::take(void)
+{
+    vector<Entry> retValue;
+    lock_guard<mutex> lock(mLock);
+
+    retValue.reserve(mOrder.size());
+    for (uint64 channel : mOrder)
+    {
+        retValue.push_back(make_pair(channel, mPending[channel]));
+    }
+
+    mPending.clear();
+    mOrder.clear();
+
+    return retValue;
+}
+
+void ChannelJournal::run(void)
+{
+    unique_lock<mutex> lock(mLock);
+
+    while (!mStop)
+    {
+        if (mPending.empty())
+        {
+            mWake.wait(lock);
+        }
+        else if (!due(chrono::steady_clock::now()))
+        {
+            mWake.wait_until(lock, mLastEvent + mQuiet);
+        }
+        else
+        {
+            lock.unlock();
+            mDue();
+            lock.lock();
+
+            // Give the batch a chance to be taken before asking again.
+            mWake.wait_for(lock, mQuiet);
+        }
+    }
+}
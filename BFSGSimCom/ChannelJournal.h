@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+
+using namespace ::std;
+
+// Collects channel events as they arrive, keeping only the net effect on each channel, so that a storm of
+// edits can be applied as one batch.
+//
+// Once events stop arriving for the quiet period, or enough channels are waiting, the journal calls its
+// due function from its own thread. That's expected to get the TS3 thread to take() the batch and apply it.
+class ChannelJournal
+{
+public:
+    enum Action
+    {
+        JOURNAL_RELOAD,
+        JOURNAL_DELETE
+    };
+
+    typedef pair<uint64, Action> Entry;
+
+    ChannelJournal(function<void(void)> due, chrono::milliseconds quiet = chrono::milliseconds(250), size_t threshold = 256);
+    ~ChannelJournal();
+
+    void reload(uint64 channel);
+    void remove(uint64 channel);
+
+    bool isDue(void);
+    vector<Entry> take(void);
+
+private:
+    function<void(void)> mDue;
+    chrono::milliseconds mQuiet;
+    size_t mThreshold;
+
+    mutex mLock;
+    condition_variable mWake;
+    bool mStop;
+
+    // The latest action for each channel, and the order the channels were first seen in.
+    unordered_map<uint64, Action> mPending;
+    vector<uint64> mOrder;
+    chrono::steady_clock::time_point mLastEvent;
+
+    thread mFlusher;
+
+    void record(uint64 channel, Action action);
+    bool due(chrono::steady_clock::time_point now);
+    void run(void);
+};
@@ -0,0 +1,370 @@
+#include <memory>
+#include <vector>
+
+#include "ChannelTables.h"
+
+using namespace std;
+
+namespace
+{
+    enum Kind
+    {
+        TABLE_CHANNELS,
+        TABLE_CHANNEL_FREQUENCY,
+        TABLE_CLOSURE
+    };
+
+    // Scans the index can answer directly - anything else is a full scan.
+    enum Plan
+    {
+        PLAN_ALL = 0,
+        PLAN_CHANNEL = 1,
+        PLAN_FREQUENCY = 2,
+        PLAN_ANCESTORS = 3,
+        PLAN_DESCENDANTS = 4
+    };
+
+    const int MAX_DEPTH = 1024;
+
+    struct Module
+    {
+        Kind kind;
+        SnapshotPublisher<ChannelIndex>* snapshots;
+    };
+
+    struct Table
+    {
+        sqlite3_vtab base;
+        const Module* module;
+    };
+
+    // A row is a record in the snapshot and, for the relations, the values that go with it.
+    struct Row
+    {
+        const ChannelIndex::Channel* channel;
+        sqlite3_int64 values[3];
+    };
+
+    struct Cursor
+    {
+        sqlite3_vtab_cursor base;
+        unique_ptr<SnapshotPublisher<ChannelIndex>::ReadGuard> snapshot;
+        vector<Row> rows;
+        size_t position;
+    };
+
+    const char* schema(Kind kind)
+    {
+        switch (kind)
+        {
+        case TABLE_CHANNELS:
+            return "CREATE TABLE x(channelId INTEGER, latitude REAL, longitude REAL, range REAL, parent INTEGER, "
+                "ordering INTEGER, name TEXT, station TEXT, topic TEXT, description TEXT)";
+        case TABLE_CHANNEL_FREQUENCY:
+            return "CREATE TABLE x(channel INTEGER, frequency INTEGER, freq833 INTEGER)";
+        default:
+            return "CREATE TABLE x(parent INTEGER, child INTEGER, depth INTEGER)";
+        }
+    }
+
+    int xConnect(sqlite3* db, void* aux, int, const char* const*, sqlite3_vtab** vtab, char**)
+    {
+        const Module* module = static_cast<const Module*>(aux);
+
+        int rc = sqlite3_declare_vtab(db, schema(module->kind));
+        if (rc != SQLITE_OK) return rc;
+
+        Table* table = new Table();
+        table->module = module;
+        *vtab = &table->base;
+
+        return SQLITE_OK;
+    }
+
+    int xDisconnect(sqlite3_vtab* vtab)
+    {
+        delete reinterpret_cast<Table*>(vtab);
+        return SQLITE_OK;
+    }
+
+    int xBestIndex(sqlite3_vtab* vtab, sqlite3_index_info* info)
+    {
+        Kind kind = reinterpret_cast<Table*>(vtab)->module->kind;
+        int equals[3] = { -1, -1, -1 };
+
+        for (int i = 0; i < info->nConstraint; i++)
+        {
+            const sqlite3_index_info::sqlite3_index_constraint& constraint = info->aConstraint[i];
+
+            if (constraint.usable && constraint.op == SQLITE_INDEX_CONSTRAINT_EQ && constraint.iColumn >= 0 && constraint.iColumn < 3)
+                equals[constraint.iColumn] = i;
+        }
+
+        // SQLite checks the constraints again itself, so nothing is marked as omitted.
+        info->idxNum = PLAN_ALL;
+        info->estimatedCost = 1000000.0;
+
+        if (kind == TABLE_CHANNELS && equals[0] >= 0)
+        {
+            info->idxNum = PLAN_CHANNEL;
+            info->aConstraintUsage[equals[0]].argvIndex = 1;
+            info->estimatedCost = 1.0;
+        }
+        else if (kind == TABLE_CHANNEL_FREQUENCY && equals[0] >= 0)
+        {
+            info->idxNum = PLAN_CHANNEL;
+            info->aConstraintUsage[equals[0]].argvIndex = 1;
+            info->estimatedCost = 5.0;
+        }
+        else if (kind == TABLE_CHANNEL_FREQUENCY && equals[1] >= 0 && equals[2] >= 0)
+        {
+            info->idxNum = PLAN_FREQUENCY;
+            info->aConstraintUsage[equals[1]].argvIndex = 1;
+            info->aConstraintUsage[equals[2]].argvIndex = 2;
+            info->estimatedCost = 20.0;
+        }
+        else if (kind == TABLE_CLOSURE && equals[1] >= 0)
+        {
+            info->idxNum = PLAN_ANCESTORS;
+            info->aConstraintUsage[equals[1]].argvIndex = 1;
+            info->estimatedCost = 10.0;
+        }
+        else if (kind == TABLE_CLOSURE && equals[0] >= 0)
+        {
+            info->idxNum = PLAN_DESCENDANTS;
+            info->aConstraintUsage[equals[0]].argvIndex = 1;
+            info->estimatedCost = 1000.0;
+        }
+
+        return SQLITE_OK;
+    }
+
+    int xOpen(sqlite3_vtab*, sqlite3_vtab_cursor** cursor)
+    {
+        Cursor* c = new Cursor();
+        c->position = 0;
+        *cursor = &c->base;
+
+        return SQLITE_OK;
+    }
+
+    int xClose(sqlite3_vtab_cursor* cursor)
+    {
+        delete reinterpret_cast<Cursor*>(cursor);
+        return SQLITE_OK;
+    }
+
+    void addRow(vector<Row>& rows, const ChannelIndex::Channel* channel, sqlite3_int64 a = 0, sqlite3_int64 b = 0, sqlite3_int64 c = 0)
+    {
+        Row row = { channel, { a, b, c } };
+        rows.push_back(row);
+    }
+
+    void addFrequencies(vector<Row>& rows, const ChannelIndex::Channel* channel)
+    {
+        for (const tuple<uint32_t, bool>& frequency : channel->frequencies)
+            addRow(rows, channel, sqlite3_int64(channel->channelID), get<0>(frequency), get<1>(frequency) ? 1 : 0);
+    }
+
+    // Every channel is its own ancestor, at depth 0, and the root is the last of them.
+    void addAncestors(vector<Row>& rows, const ChannelIndex& index, const ChannelIndex::Channel* channel)
+    {
+        const ChannelIndex::Channel* ancestor = channel;
+
+        for (int depth = 0; ancestor != NULL && depth < MAX_DEPTH; depth++)
+        {
+            addRow(rows, channel, sqlite3_int64(ancestor->channelID), sqlite3_int64(channel->channelID), depth);
+            if (ancestor->channelID == 0) break;
+
+            ancestor = index.getChannel(ancestor->parent);
+        }
+    }
+
+    void addDescendants(vector<Row>& rows, const ChannelIndex& index, const ChannelIndex::Channel* channel)
+    {
+        vector<pair<uint64, int>> pending = { make_pair(channel->channelID, 0) };
+
+        while (!pending.empty())
+        {
+            uint64 ch = pending.back().first;
+            int depth = pending.back().second;
+            pending.pop_back();
+
+            const ChannelIndex::Channel* descendant = index.getChannel(ch);
+            if (descendant == NULL || depth >= MAX_DEPTH) continue;
+
+            addRow(rows, descendant, sqlite3_int64(channel->channelID), sqlite3_int64(ch), depth);
+
+            for (uint64 child : index.getChildren(ch))
+                pending.push_back(make_pair(child, depth + 1));
+        }
+    }
+
+    int xFilter(sqlite3_vtab_cursor* cursor, int idxNum, const char*, int argc, sqlite3_value** argv)
+    {
+        Cursor* c = reinterpret_cast<Cursor*>(cursor);
+        const Module* module = reinterpret_cast<Table*>(cursor->pVtab)->module;
+
+        // Let go of any earlier snapshot before taking the current one.
+        c->snapshot.reset();
+        c->snapshot.reset(new SnapshotPublisher<ChannelIndex>::ReadGuard(*module->snapshots));
+        c->rows.clear();
+        c->position = 0;
+
+        const ChannelIndex& index = *c->snapshot->get();
+
+        if (idxNum == PLAN_FREQUENCY && argc >= 2)
+        {
+            uint32_t frequency = uint32_t(sqlite3_value_int64(argv[0]));
+            bool freq833 = sqlite3_value_int(argv[1]) != 0;
+
+            for (uint64 ch : index.getChannelsOnFrequency(frequency, freq833))
+            {
+                const ChannelIndex::Channel* channel = index.getChannel(ch);
+                if (channel != NULL) addRow(c->rows, channel, sqlite3_int64(ch), frequency, freq833 ? 1 : 0);
+            }
+
+            return SQLITE_OK;
+        }
+
+        vector<const ChannelIndex::Channel*> channels;
+
+        if (idxNum != PLAN_ALL && argc >= 1)
+        {
+            const ChannelIndex::Channel* channel = index.getChannel(uint64(sqlite3_value_int64(argv[0])));
+            if (channel != NULL) channels.push_back(channel);
+        }
+        else
+        {
+            for (const auto& entry : index.getChannels())
+                channels.push_back(entry.second.get());
+        }
+
+        for (const ChannelIndex::Channel* channel : channels)
+        {
+            switch (module->kind)
+            {
+            case TABLE_CHANNELS:
+                addRow(c->rows, channel);
+                break;
+            case TABLE_CHANNEL_FREQUENCY:
+                addFrequencies(c->rows, channel);
+                break;
+            default:
+                if (idxNum == PLAN_DESCENDANTS)
+                    addDescendants(c->rows, index, channel);
+                else
+                    addAncestors(c->rows, index, channel);
+                break;
+            }
+        }
+
+        return SQLITE_OK;
+    }
+
+    int xNext(sqlite3_vtab_cursor* cursor)
+    {
+        reinterpret_cast<Cursor*>(cursor)->position++;
+        return SQLITE_OK;
+    }
+
+    int xEof(sqlite3_vtab_cursor* cursor)
+    {
+        Cursor* c = reinterpret_cast<Cursor*>(cursor);
+        return c->position >= c->rows.size();
+    }
+
+    // Strings are handed over as they are - the snapshot they're in is held until the cursor is done with.
+    void resultText(sqlite3_context* context, const char* text)
+    {
+        sqlite3_result_text(context, text, -1, SQLITE_STATIC);
+    }
+
+    int xColumn(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int column)
+    {
+        Cursor* c = reinterpret_cast<Cursor*>(cursor);
+        const Row& row = c->rows[c->position];
+
+        if (reinterpret_cast<Table*>(cursor->pVtab)->module->kind != TABLE_CHANNELS)
+        {
+            sqlite3_result_int64(context, row.values[column]);
+            return SQLITE_OK;
+        }
+
+        const ChannelIndex::Channel& channel = *row.channel;
+
+        switch (column)
+        {
+        case 0: sqlite3_result_int64(context, sqlite3_int64(channel.channelID)); break;
+        case 1: channel.hasLatLon ? sqlite3_result_double(context, channel.lat) : sqlite3_result_null(context); break;
+        case 2: channel.hasLatLon ? sqlite3_result_double(context, channel.lon) : sqlite3_result_null(context); break;
+        case 3: sqlite3_result_double(context, channel.range); break;
+        case 4: sqlite3_result_int64(context, sqlite3_int64(channel.parent)); break;
+        case 5: sqlite3_result_int64(context, sqlite3_int64(channel.order)); break;
+        case 6: resultText(context, channel.name); break;
+        case 7: resultText(context, channel.station); break;
+        case 8: (channel.text == NULL) ? sqlite3_result_null(context) : resultText(context, channel.text->topic.c_str()); break;
+        case 9: (channel.text == NULL) ? sqlite3_result_null(context) : resultText(context, channel.text->description.c_str()); break;
+        default: sqlite3_result_null(context); break;
+        }
+
+        return SQLITE_OK;
+    }
+
+    int xRowid(sqlite3_vtab_cursor* cursor, sqlite3_int64* rowid)
+    {
+        *rowid = sqlite3_int64(reinterpret_cast<Cursor*>(cursor)->position);
+        return SQLITE_OK;
+    }
+
+    void destroyModule(void* aux)
+    {
+        delete static_cast<Module*>(aux);
+    }
+
+    sqlite3_module makeModule(void)
+    {
+        sqlite3_module module = {};
+
+        // No xUpdate, so the tables are read-only.
+        module.iVersion = 1;
+        module.xCreate = xConnect;
+        module.xConnect = xConnect;
+        module.xBestIndex = xBestIndex;
+        module.xDisconnect = xDisconnect;
+        module.xDestroy = xDisconnect;
+        module.xOpen = xOpen;
+        module.xClose = xClose;
+        module.xFilter = xFilter;
+        module.xNext = xNext;
+        module.xEof = xEof;
+        module.xColumn = xColumn;
+        module.xRowid = xRowid;
+
+        return module;
+    }
+
+    const sqlite3_module aModule = makeModule();
+}
+
+int ChannelTables::registerModules(sqlite3* db, SnapshotPublisher<ChannelIndex>* snapshots)
+{
+    static const pair<const char*, Kind> modules[] = {
+        make_pair("bfsg_channels", TABLE_CHANNELS),
+        make_pair("bfsg_channel_frequency", TABLE_CHANNEL_FREQUENCY),
+        make_pair("bfsg_closure", TABLE_CLOSURE)
+    };
+
+    for (const pair<const char*, Kind>& entry : modules)
+    {
+        Module* module = new Module();
+        module->kind = entry.second;
+        module->snapshots = snapshots;
+
+        // SQLite owns the module data from here, even if registering fails.
+        int rc = sqlite3_create_module_v2(db, entry.first, &aModule, module, &destroyModule);
+        if (rc != SQLITE_OK) return rc;
+    }
+
+    return SQLITE_OK;
+}
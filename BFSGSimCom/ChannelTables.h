@@ -0,0 +1,25 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include "ChannelIndex.h"
+#include "SnapshotPublisher.h"
+
+using namespace ::std;
+
+// Read-only SQLite virtual tables over the published channel index, so the channels can still be looked
+// at with SQL without SQL being anywhere near a lookup.
+//
+// Three modules are registered, matching the tables the channels used to be kept in:
+//   bfsg_channels          (channelId, latitude, longitude, range, parent, ordering, name, station, topic, description)
+//   bfsg_channel_frequency (channel, frequency, freq833)
+//   bfsg_closure           (parent, child, depth)
+//
+// Each scan holds on to the snapshot that was current when it started, and reads the records in it
+// directly rather than copying them. Scans by channel, by frequency, and closure scans by parent or child
+// go straight to the index.
+class ChannelTables
+{
+public:
+    static int registerModules(sqlite3* db, SnapshotPublisher<ChannelIndex>* snapshots);
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace ::std;
+
+// An unordered map split into shards, each shared between copies until one of them changes it. Copying the map
+// only copies the pointers to its shards, and a change to a copy copies just the shard it touches. The number of
+// shards grows with the map so that a shard stays small, which keeps both of those cheap however big it gets.
+//
+// A copy that's only ever read can be read from any number of threads, while the copy it came from is changed.
+template<class K, class V> class CowMap
+{
+public:
+    typedef unordered_map<K, V> Shard;
+    typedef typename Shard::value_type value_type;
+
+    class const_iterator
+    {
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef typename CowMap::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type* pointer;
+        typedef const value_type& reference;
+
+        const_iterator() : mMap(nullptr), mShard(0) {};
+
+        reference operator*() const { return *mEntry; };
+        pointer operator->() const { return &*mEntry; };
+
+        const_iterator& operator++()
+        {
+            ++mEntry;
+            skip();
+            return *this;
+        };
+
+        const_iterator operator++(int)
+        {
+            const_iterator retValue = *this;
+            ++*this;
+            return retValue;
+        };
+
+        bool operator==(const const_iterator& rhs) const { return mShard == rhs.mShard && (mShard == mMap->mShards.size() || mEntry == rhs.mEntry); };
+        bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); };
+
+    private:
+        friend class CowMap;
+
+        const CowMap* mMap;
+        size_t mShard;
+        typename Shard::const_iterator mEntry;
+
+        const_iterator(const CowMap* map, size_t shard) : mMap(map), mShard(shard)
+        {
+            if (mShard < mMap->mShards.size() && mMap->mShards[mShard] != nullptr) mEntry = mMap->mShards[mShard]->begin();
+            skip();
+        };
+
+        // Moves on past the end of each shard to the start of the next one that has anything in it.
+        void skip(void)
+        {
+            const vector<shared_ptr<Shard>>& shards = mMap->mShards;
+
+            while (mShard < shards.size() && (shards[mShard] == nullptr || mEntry == shards[mShard]->end()))
+            {
+                if (++mShard < shards.size() && shards[mShard] != nullptr) mEntry = shards[mShard]->begin();
+            }
+        };
+    };
+
+    CowMap() : mShards(MIN_SHARDS), mSize(0) {};
+
+    size_t size(void) const { return mSize; };
+    bool empty(void) const { return mSize == 0; };
+
+    // The value for the key, or null if there isn't one.
+    const V* find(const K& key) const
+    {
+        const shared_ptr<Shard>& shard = mShards[shardOf(key)];
+        if (shard == nullptr) return nullptr;
+
+        auto entry = shard->find(key);
+        return (entry == shard->end()) ? nullptr : &entry->second;
+    };
+
+    size_t count(const K& key) const { return find(key) == nullptr ? 0 : 1; };
+
+    // The value for the key to change, added if it isn't there already.
+    V& operator[](const K& key)
+    {
+        if (mSize >= mShards.size() * SHARD_SIZE && find(key) == nullptr) grow();
+
+        Shard& shard = writable(shardOf(key));
+        size_t before = shard.size();
+
+        V& retValue = shard[key];
+        mSize += shard.size() - before;
+
+        return retValue;
+    };
+
+    // The value for the key to change, or null if there isn't one. Nothing is copied if there isn't.
+    V* edit(const K& key)
+    {
+        size_t index = shardOf(key);
+        if (mShards[index] == nullptr || mShards[index]->find(key) == mShards[index]->end()) return nullptr;
+
+        return &writable(index).find(key)->second;
+    };
+
+    bool erase(const K& key)
+    {
+        size_t index = shardOf(key);
+        if (mShards[index] == nullptr || mShards[index]->find(key) == mShards[index]->end()) return false;
+
+        writable(index).erase(key);
+        mSize--;
+
+        return true;
+    };
+
+    void clear(void)
+    {
+        mShards.assign(MIN_SHARDS, nullptr);
+        mSize = 0;
+    };
+
+    const_iterator begin(void) const { return const_iterator(this, 0); };
+    const_iterator end(void) const { return const_iterator(this, mShards.size()); };
+
+private:
+    // How many entries a shard holds on average before the map doubles its shards.
+    static const size_t SHARD_SIZE = 32;
+    static const size_t MIN_SHARDS = 16;
+
+    vector<shared_ptr<Shard>> mShards;
+    size_t mSize;
+
+    size_t shardOf(const K& key) const { return hash<K>()(key) % mShards.size(); };
+
+    // A shard this copy can change - its own already, or a copy of the one it's been sharing. A shard isn't
+    // shared once nothing else holds it, so whatever still holds it can only be this copy.
+    Shard& writable(size_t index)
+    {
+        shared_ptr<Shard>& shard = mShards[index];
+
+        if (shard == nullptr)
+            shard = make_shared<Shard>();
+        else if (shard.use_count() > 1)
+            shard = make_shared<Shard>(*shard);
+
+        return *shard;
+    };
+
+    // Twice the shards, with every entry moved to its new one. Everything is copied, but only each time the
+    // map doubles in size, so it comes to one more copy of each entry overall.
+    void grow(void)
+    {
+        vector<shared_ptr<Shard>> old(mShards.size() * 2);
+        old.swap(mShards);
+
+        for (const shared_ptr<Shard>& shard : old)
+        {
+            if (shard == nullptr) continue;
+
+            for (const value_type& entry : *shard)
+                writable(shardOf(entry.first)).insert(entry);
+        }
+    };
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+using namespace ::std;
+
+// Runs everything that changes the plugin's state on one thread of its own, one thing at a time, so none
+// of it needs a lock and nothing sees another change half done.
+//
+// Events are posted as functions onto a lock free queue, which any thread can add to (Vyukov's intrusive
+// multiple producer, single consumer queue). Simulator samples don't queue - only the latest is kept, with
+// the merge function folding any sample it replaces into it, so a slow decision never leaves a backlog of
+// stale positions behind it. Samples must only come from one thread.
+//
+// Neither posting nor sampling waits for the decision thread. They only take its lock, briefly, to wake it
+// when it may be asleep.
+template <class Sample>
+class DecisionActor
+{
+public:
+    typedef function<void(void)> Message;
+    typedef function<void(const Sample&)> Decide;
+    typedef function<Sample(const Sample& older, const Sample& newer)> Merge;
+
+    DecisionActor(Decide decide, Merge merge) :
+        mDecide(decide),
+        mMerge(merge),
+        mHead(&mStub),
+        mTail(&mStub),
+        mLatest(NULL),
+        mSignalled(false),
+        mStop(false)
+    {
+        mStub.next = NULL;
+        mWorker = thread(&DecisionActor::run, this);
+    }
+
+    // Anything still waiting when it's stopped is dropped.
+    ~DecisionActor()
+    {
+        mStop = true;
+        wake();
+        mWorker.join();
+
+        Message message;
+        while (pop(message));
+        delete mLatest.exchange(NULL);
+    }
+
+    void post(Message message)
+    {
+        Node* node = new Node;
+        node->message = message;
+        node->next = NULL;
+
+        Node* prev = mHead.exchange(node);
+        prev->next = node;
+
+        wake();
+    }
+
+    void sample(const Sample& sample)
+    {
+        Sample* fresh = new Sample(sample);
+
+        // Only this thread ever puts a sample in, so whatever's taken out here is ours to fold in.
+        Sample* older = mLatest.exchange(NULL);
+        if (older != NULL)
+        {
+            *fresh = mMerge(*older, *fresh);
+            delete older;
+        }
+
+        mLatest.exchange(fresh);
+
+        wake();
+    }
+
+    bool onDecisionThread(void) const { return this_thread::get_id() == mWorker.get_id(); };
+
+private:
+    struct Node
+    {
+        atomic<Node*> next;
+        Message message;
+    };
+
+    Decide mDecide;
+    Merge mMerge;
+
+    Node mStub;
+    atomic<Node*> mHead;
+    Node* mTail;
+
+    atomic<Sample*> mLatest;
+
+    mutex mLock;
+    condition_variable mWake;
+    atomic<bool> mSignalled;
+    atomic<bool> mStop;
+
+    thread mWorker;
+
+    // Only the first signal since the decision thread last looked needs to wake it.
+    void wake(void)
+    {
+        if (!mSignalled.exchange(true))
+        {
+            { lock_guard<mutex> lock(mLock); }
+            mWake.notify_one();
+        }
+    }
+
+    // Takes the next message off the queue. Only ever called from the decision thread.
+    bool pop(Message& message)
+    {
+        Node* tail = mTail;
+        Node* next = tail->next;
+
+        if (tail == &mStub)
+        {
+            if (next == NULL) return false;
+
+            mTail = next;
+            tail = next;
+            next = next->next;
+        }
+
+        if (next != NULL)
+        {
+            mTail = next;
+            message = tail->message;
+            delete tail;
+            return true;
+        }
+
+        // The last node can only go once something else is behind it, so put the stub back in.
+        if (tail != mHead.load()) return false;
+
+        mStub.next = NULL;
+        Node* prev = mHead.exchange(&mStub);
+        prev->next = &mStub;
+
+        next = tail->next;
+        if (next != NULL)
+        {
+            mTail = next;
+            message = tail->message;
+            delete tail;
+            return true;
+        }
+
+        return false;
+    }
+
+    void run(void)
+    {
+        while (!mStop)
+        {
+            Message message;
+            while (!mStop && pop(message))
+                message();
+
+            Sample* latest = mLatest.exchange(NULL);
+            if (latest != NULL)
+            {
+                mDecide(*latest);
+                delete latest;
+                continue;
+            }
+
+            unique_lock<mutex> lock(mLock);
+            mWake.wait(lock, [this]() { return mSignalled.exchange(false) || mStop; });
+        }
+    }
+};
@@ -1,377 +1,245 @@
+#include <algorithm>
 #include <thread>
 #include <chrono>
 #include <sstream>
 
 #include "FSUIPCWrapper.h"
-#include "TS3Channels.h"
-
-bool FSUIPCWrapper::cFSUIPCConnected = false;
-bool FSUIPCWrapper::cRun = false;
-
-FSUIPCWrapper::FSUIPCWrapper(void(*cb)(SimComData))
+#include "Geo.h"
+
+const FSUIPCWrapper::ComRadio FSUIPCWrapper::None;
+const FSUIPCWrapper::ComRadio FSUIPCWrapper::Com1;
+const FSUIPCWrapper::ComRadio FSUIPCWrapper::Com2;
+const FSUIPCWrapper::ComRadio FSUIPCWrapper::Com12;
+
+std::atomic<bool> FSUIPCWrapper::cFSUIPCConnected(false);
+std::atomic<bool> FSUIPCWrapper::cRun(false);
+std::atomic<int> FSUIPCWrapper::cPollInterval(100);
+std::atomic<int> FSUIPCWrapper::cPollMode(PollScheduler::POLL_NORMAL);
+
+FSUIPCWrapper::FSUIPCWrapper(void(*cb)(SimComData), std::shared_ptr<SimSource> simSource, PollScheduler::Rates pollRates) :
+	source(simSource),
+	scheduler(pollRates),
+	lastForced(std::chrono::steady_clock::now()),
+	firstDisconnectedPass(true),
+	firstConnectedPass(true),
+	cLat(0.0),
+	cLon(0.0),
+	callback(cb)
 {
-	DWORD dwResult;
-
-	checkConnection(&dwResult);
-	callback = cb;
 }
 
 void FSUIPCWrapper::start(void)
 {
 	cRun = true;
 
-	t1 = new std::thread(&FSUIPCWrapper::workerThread, FSUIPCWrapper(callback));
+	t1 = new std::thread(&FSUIPCWrapper::workerThread, this);
 }
 
 void FSUIPCWrapper::stop(void)
 {
-	cRun = false;
+	{
+		std::lock_guard<std::mutex> lock(waitLock);
+		cRun = false;
+	}
+
+	// Whatever the worker's waiting on, it stops waiting now.
+	wake.notify_all();
+	source->interrupt();
 
-	// There's no harm in calling this whether FSUIPC is open or not.
-	::FSUIPC_Close();
+	if (t1 != NULL)
+	{
+		t1->join();
+		delete t1;
+		t1 = NULL;
+	}
 
-	if (t1 != NULL) t1->join();
+	source->close();
+	cFSUIPCConnected = false;
+
+	if (recorder != NULL) recorder->close();
 }
 
+// Polls on a fixed grid - each poll is due the interval after the last was due, not after it finished, so
+// the time taken reading the sim doesn't stretch the period.
 void FSUIPCWrapper::workerThread(void)
 {
-	WORD simCom1;
-	WORD simCom1s;
-	WORD simCom2;
-	WORD simCom2s;
-	BYTE simRadSw;
-	WORD simOnGnd;
-	int64_t simLatitude;
-	int64_t simLongitude;
-
-	DWORD simCom1_833;
-	DWORD simCom2_833;
-	DWORD simCom1s_833;
-	DWORD simCom2s_833;
-
-	int counter = 0;
-
-	bool firstPass = true;
-
-	bool firstDisconnectedPass = true;
-	bool firstConnectedPass = true;
+	std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+	bool blEarly = false;
 
 	while (cRun)
 	{
-		DWORD dwResult;
-		checkConnection(&dwResult);
-
-		simIsXPlane = (FSUIPC_FS_Version == 8) && (FSUIPC_Version & 0xffff0000) == 0x50000000;
-		simIs833Capable = simIsXPlane;
-
-		FSUIPC_Read(0x034E, 2, &simCom1);
-		FSUIPC_Read(0x3118, 2, &simCom2);
-		FSUIPC_Read(0x311A, 2, &simCom1s);
-		FSUIPC_Read(0x311C, 2, &simCom2s);
-		FSUIPC_Read(0x3122, 1, &simRadSw);
-		FSUIPC_Read(0x0366, 2, &simOnGnd);
-		FSUIPC_Read(0x0560, 8, &simLatitude);
-		FSUIPC_Read(0x0568, 8, &simLongitude);
-
-		FSUIPC_Read(0x05c4, 4, &simCom1_833);
-		FSUIPC_Read(0x05c8, 4, &simCom2_833);
-		FSUIPC_Read(0x05cc, 4, &simCom1s_833);
-		FSUIPC_Read(0x05d0, 4, &simCom2s_833);
-
-		if (FSUIPC_Process())
-		{
-			bool blComChanged = false;
-			bool blPosChange = false;
-
-			bool blOtherChanged = false;
-
-			currentLat = double(simLatitude);
-			currentLat *= 90.0 / (10001750.0 * 65536.0 * 65536.0);
-			currentLon = double(simLongitude);
-			currentLon *= 360.0 / (65536.0 * 65536.0 * 65536.0 * 65536.0);
-
-			// ALways 25KHz for the time being
-			if (!simIs833Capable)
-			{
-				if (simCom1 != cCom1Freq)
-				{
-					blComChanged = true;
-					cCom1Freq = simCom1;
-				}
-
-				if (simCom1s != cCom1Sby)
-				{
-					blComChanged = true;
-					cCom1Sby = simCom1s;
-				}
-
-				if (simCom2 != cCom2Freq)
-				{
-					blComChanged = true;
-					cCom2Freq = simCom2;
-				}
-
-				if (simCom2s != cCom2Sby)
-				{
-					blComChanged = true;
-					cCom2Sby = simCom2s;
-				}
-
-				// Save 833 values in case the configuration changes
-				cCom1Freq833 = simCom1_833;
-				cCom1Sby833 = simCom1s_833;
-				cCom2Freq833 = simCom2_833;
-				cCom2Sby833 = simCom2s_833;
-			}
-			else
-			{
-				if (simCom1_833 != cCom1Freq833)
-				{
-					blComChanged = true;
-					cCom1Freq833 = simCom1_833;
-				}
-
-				if (simCom1s_833 != cCom1Sby833)
-				{
-					blComChanged = true;
-					cCom1Sby833 = simCom1s_833;
-				}
-
-				if (simCom2_833 != cCom2Freq833)
-				{
-					blComChanged = true;
-					cCom2Freq833 = simCom2_833;
-				}
-
-				if (simCom2s_833 != cCom2Sby833)
-				{
-					blComChanged = true;
-					cCom2Sby833 = simCom2s_833;
-				}
-
-				// Save the 25KHz values in case the switch changes
-				cCom1Freq = simCom1;
-				cCom1Sby = simCom1s;
-				cCom2Freq = simCom2;
-				cCom2Sby = simCom2s;
-			}
-
-			if (simRadSw != cSelectedCom)
-			{
-				blComChanged = true;
-				cSelectedCom = simRadSw;
-			}
-
-			if (simOnGnd != cWoW)
-			{
-				blOtherChanged = true;
-				cWoW = simOnGnd;
-			}
-
-			// This is set to fire if we've moved more than 0.5nm from where we were the last time it fired,
-			if (TS3Channels::getDistanceBetweenLatLonInNm(currentLat, currentLon, cLat, cLon) > 0.5)
-			{
-				blPosChange = true;
+		std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
 
-				// Reset counter and save the last position
-				counter = 0;
-				cLat = currentLat;
-				cLon = currentLon;
-			}
-
-			// This makes sure we go through the callback at least every 10 seconds - is it redundant now?
-			if (++counter >= 100)
-			{
-				blOtherChanged = true;
-				counter = 0;
-			}
+		// A poll for data that's just arrived wasn't due, so it wasn't late either.
+		if (!blEarly) timing.jitter.record(started - due);
 
-			if (blComChanged || blPosChange || blOtherChanged || firstConnectedPass)
-			{
-				if (callback != NULL)
-				{
-					(*callback)(getSimComData(blComChanged, blPosChange, blOtherChanged));
-				}
+		std::chrono::milliseconds wait = poll();
 
-				firstConnectedPass = false;
-			}
+		std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+		timing.work.record(finished - started);
 
-			firstDisconnectedPass = true;
+		// Anything new starts the grid again from now.
+		due = (blEarly ? started : due) + wait;
 
-		}
-		else
+		// Running over is counted, and the grid starts again rather than trying to catch up.
+		if (due <= finished)
 		{
-			if (firstDisconnectedPass)
-			{
-				if (callback != NULL)
-				{
-					(*callback)(getSimComData(false, false, false));
-				}
-
-				firstDisconnectedPass = false;
-			}
+			timing.overruns++;
+			due = finished;
+		}
 
-			::FSUIPC_Close();
-			cFSUIPCConnected = false;
+		blEarly = waitUntil(due);
+	}
+}
 
-			firstConnectedPass = true;
+// True if the source had something new before the deadline.
+bool FSUIPCWrapper::waitUntil(std::chrono::steady_clock::time_point deadline)
+{
+	if (source->canWait())
+	{
+		// Stopping interrupts this, but it's kept to short steps in case the source can't be.
+		while (cRun)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= deadline) break;
 
+			if (source->waitForData((std::min)(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now), std::chrono::milliseconds(100))))
+				return cRun;
 		}
 
-		// Fetch data from the simulator every 10th of a second
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
+		return false;
 	}
-};
 
+	std::unique_lock<std::mutex> lock(waitLock);
+	wake.wait_until(lock, deadline, []() { return !cRun; });
 
-FSUIPCWrapper::SimComData FSUIPCWrapper::getSimComData(bool blComChanged, bool blPosChange, bool blOtherChanged) {
+	return false;
+}
 
-	SimComData simcomdata;
+std::chrono::milliseconds FSUIPCWrapper::poll(void)
+{
+	std::chrono::milliseconds wait;
+	SimSource::Snapshot sim;
 
-	// Depending if we're working on a 25KHz only radio (true) or an 8.333KHz radio (false)...
-	if (!simIs833Capable)
-	{
-		simcomdata.iCom1Freq = 100000 + 10000 * ((cCom1Freq & 0xf000) >> 12) + 1000 * ((cCom1Freq & 0x0f00) >> 8) + 100 * ((cCom1Freq & 0x00f0) >> 4) + 10 * (cCom1Freq & 0x000f);
-		simcomdata.iCom1Sby = 100000 + 10000 * ((cCom1Sby & 0xf000) >> 12) + 1000 * ((cCom1Sby & 0x0f00) >> 8) + 100 * ((cCom1Sby & 0x00f0) >> 4) + 10 * (cCom1Sby & 0x000f);
-		simcomdata.iCom2Freq = 100000 + 10000 * ((cCom2Freq & 0xf000) >> 12) + 1000 * ((cCom2Freq & 0x0f00) >> 8) + 100 * ((cCom2Freq & 0x00f0) >> 4) + 10 * (cCom2Freq & 0x000f);
-		simcomdata.iCom2Sby = 100000 + 10000 * ((cCom2Sby & 0xf000) >> 12) + 1000 * ((cCom2Sby & 0x0f00) >> 8) + 100 * ((cCom2Sby & 0x00f0) >> 4) + 10 * (cCom2Sby & 0x000f);
-
-		// If it's a 25KHz frequency, then we might need to add the last digit.
-		if (simcomdata.iCom1Freq % 50 == 20) simcomdata.iCom1Freq += 5;
-		if (simcomdata.iCom1Sby % 50 == 20) simcomdata.iCom1Sby += 5;
-		if (simcomdata.iCom2Freq % 50 == 20) simcomdata.iCom2Freq += 5;
-		if (simcomdata.iCom2Sby % 50 == 20) simcomdata.iCom2Sby += 5;
-	}
-	else
-	{
-		// No fancy stuff here (yet) - just pull the latest values.
-		simcomdata.iCom1Freq = (int)(0.001 * cCom1Freq833);
-		simcomdata.iCom1Sby = (int)(0.001 * cCom1Sby833);
-		simcomdata.iCom2Freq = (int)(0.001 * cCom2Freq833);
-		simcomdata.iCom2Sby = (int)(0.001 * cCom2Sby833);
-	}
+	cFSUIPCConnected = source->open();
 
-	// This is a kluge because XPUIPC doesn't report the correct channel and the config file that comes with it doesn't seem to work as advertised.
-	// Look for a FSUIPC_Version with an most significant half word of 0x50000000 AND an FS Version of 8 (FSX).
-	// FSUIPC 5 is specific to P3D which has an FS version of 10.
-	if (simIsXPlane)
-		simcomdata.selectedCom = ComRadio(((cSelectedCom & 0x80) ? None : Com1) + ((cSelectedCom & 0x40) ? None : Com2));
-	else
-		simcomdata.selectedCom = ComRadio(((cSelectedCom & 0x80) ? Com1 : None) + ((cSelectedCom & 0x40) ? Com2 : None));
+	bool blRead = cFSUIPCConnected && source->read(sim);
 
-	simcomdata.blComChanged = blComChanged;
+	if (recorder != NULL)
+	{
+		if (blRead)
+			recorder->record(sim);
+		else
+			recorder->recordDisconnected();
+	}
 
-	// Required for reporting...
-	simcomdata.blWoW = (cWoW != 0);
+	if (blRead)
+	{
+		bool blComChanged = false;
+		bool blPosChange = false;
 
-	// And finally, report the aircraft position.
-	simcomdata.dLat = currentLat;
-	simcomdata.dLon = currentLon;
+		bool blOtherChanged = false;
 
-	simcomdata.blPosChanged = blPosChange;
+		// The source has already picked the 25KHz or 8.33KHz values, so a change of spacing shows up as a change of frequency.
+		if (sim.com1 != last.com1 || sim.com1Sby != last.com1Sby || sim.com2 != last.com2 || sim.com2Sby != last.com2Sby || sim.is833 != last.is833)
+			blComChanged = true;
 
-	simcomdata.blOtherChanged = blOtherChanged;
-
-	simcomdata.bl833Capable = simIs833Capable;
+		if (sim.selectedCom != last.selectedCom)
+			blComChanged = true;
 
-	return simcomdata;
-};
+		if (sim.onGround != last.onGround)
+			blOtherChanged = true;
 
+		last = sim;
 
+		// This is set to fire if we've moved more than 0.5nm from where we were the last time it fired,
+		if (getDistanceBetweenLatLonInNm(sim.lat, sim.lon, cLat, cLon) > 0.5)
+		{
+			blPosChange = true;
 
-// Check connection returns TRUE if connected, and FALSE if not...
-BOOL FSUIPCWrapper::checkConnection(DWORD* pdwResult)
-{
-	BOOL retValue = 0;
+			// Reset the timer and save the last position
+			lastForced = std::chrono::steady_clock::now();
+			cLat = sim.lat;
+			cLon = sim.lon;
+		}
 
-	if (!cFSUIPCConnected)
-	{
-		try
+		// This makes sure we go through the callback at least every 10 seconds - is it redundant now?
+		if (std::chrono::steady_clock::now() - lastForced >= std::chrono::seconds(10))
 		{
-			retValue = ::FSUIPC_Open(SIM_ANY, pdwResult);
-			cFSUIPCConnected = (retValue != FALSE) || (*pdwResult == FSUIPC_ERR_OPEN);
+			blOtherChanged = true;
+			lastForced = std::chrono::steady_clock::now();
 		}
-		catch (...)
+
+		if (blComChanged || blPosChange || blOtherChanged || firstConnectedPass)
 		{
-			retValue = FALSE;
-			cFSUIPCConnected = false;
+			if (callback != NULL)
+			{
+				(*callback)(getSimComData(blComChanged, blPosChange, blOtherChanged));
+			}
+
+			firstConnectedPass = false;
 		}
+
+		firstDisconnectedPass = true;
+
+		wait = scheduler.next(true, blComChanged);
 	}
 	else
 	{
-		retValue = TRUE;
-	}
+		// A source that couldn't be opened has nothing to close, and may be part way to opening.
+		if (cFSUIPCConnected) source->close();
+		cFSUIPCConnected = false;
 
-	return retValue;
-}
+		if (firstDisconnectedPass)
+		{
+			if (callback != NULL)
+			{
+				(*callback)(getSimComData(false, false, false));
+			}
 
+			firstDisconnectedPass = false;
+		}
 
-BOOL FSUIPCWrapper::FSUIPC_Read(DWORD dwOffset, DWORD dwSize, void* pDest)
-{
-	BOOL retValue = 0;
-	DWORD dwResult = FSUIPC_ERR_OK;
+		firstConnectedPass = true;
 
-	//    if (checkConnection(&dwResult))
-	//    {
-	try
-	{
-		retValue = ::FSUIPC_Read(dwOffset, dwSize, pDest, &dwResult);
-	}
-	catch (...)
-	{
-		retValue = FALSE;
+		wait = scheduler.next(false, false);
 	}
-	//    }
 
-	cFSUIPCConnected = (dwResult == FSUIPC_ERR_OK);
+	cPollInterval = int(wait.count());
+	cPollMode = scheduler.getMode();
 
-	return retValue;
+	return wait;
 }
 
-BOOL FSUIPCWrapper::FSUIPC_Write(DWORD dwOffset, DWORD dwSize, void* pSrc)
-{
-	BOOL retValue = 0;
-	DWORD dwResult;
 
-	//    if (checkConnection(&dwResult))
-	//    {
-	try
-	{
-		retValue = ::FSUIPC_Write(dwOffset, dwSize, pSrc, &dwResult);
-	}
-	catch (...)
-	{
-		retValue = FALSE;
-	}
-	//    }
+FSUIPCWrapper::SimComData FSUIPCWrapper::getSimComData(bool blComChanged, bool blPosChange, bool blOtherChanged) {
 
-	cFSUIPCConnected = (dwResult != FSUIPC_ERR_NOTOPEN);
+	SimComData simcomdata;
 
-	return retValue;
-}
+	simcomdata.iCom1Freq = last.com1;
+	simcomdata.iCom1Sby = last.com1Sby;
+	simcomdata.iCom2Freq = last.com2;
+	simcomdata.iCom2Sby = last.com2Sby;
 
-BOOL FSUIPCWrapper::FSUIPC_Process()
-{
-	BOOL retValue = 0;
-	DWORD dwResult = FSUIPC_ERR_NOTOPEN;
+	simcomdata.selectedCom = last.selectedCom;
 
-	//    if (checkConnection(&dwResult))
-	//    {
-	try
-	{
-		retValue = ::FSUIPC_Process(&dwResult);
-	}
-	catch (...)
-	{
-		retValue = FALSE;
-	}
-	//    }
+	simcomdata.blComChanged = blComChanged;
 
-	cFSUIPCConnected = (dwResult == FSUIPC_ERR_OK);
+	// Required for reporting...
+	simcomdata.blWoW = last.onGround;
 
-	return retValue;
-}
+	// And finally, report the aircraft position.
+	simcomdata.dLat = last.lat;
+	simcomdata.dLon = last.lon;
+
+	simcomdata.blPosChanged = blPosChange;
+
+	simcomdata.blOtherChanged = blOtherChanged;
+
+	simcomdata.bl833Capable = last.is833;
+
+	return simcomdata;
+};
 
 std::string FSUIPCWrapper::toString(FSUIPCWrapper::SimComData simComData)
 {
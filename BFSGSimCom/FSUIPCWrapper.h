@@ -1,21 +1,29 @@
 #pragma once
 
-#include <windows.h>
-
 #include <thread>
-
-#include "FSUIPC_User.h"
-
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "SimSource.h"
+#include "SimRecorder.h"
+#include "PollScheduler.h"
+#include "LatencyHistogram.h"
+
+// Polls a sim source, working out what's changed and telling the callback about it. Nothing here
+// depends on where the data comes from, so it runs as well over a scripted flight as over FSUIPC.
 class FSUIPCWrapper
 {
 public:
-    enum ComRadio
-    {
-        None = 0,
-        Com1 = 1,
-        Com2 = 2,
-        Com12 = 3
-    };
+    typedef SimSource::ComRadio ComRadio;
+
+    static const ComRadio None = SimSource::None;
+    static const ComRadio Com1 = SimSource::Com1;
+    static const ComRadio Com2 = SimSource::Com2;
+    static const ComRadio Com12 = SimSource::Com12;
 
     struct SimComData {
         int iCom1Freq;
@@ -32,54 +40,93 @@ public:
 		bool bl833Capable;
     };
 
+    // Where the polling time goes. Jitter is how late each poll started after it was due, work is how long
+    // reading the sim and the callback took, and an overrun is a poll that took longer than the interval.
+    struct PollTiming
+    {
+        LatencyHistogram jitter;
+        LatencyHistogram work;
+        std::atomic<uint64_t> overruns;
+
+        PollTiming() : overruns(0) {};
+    };
+
 private:
-    static bool cFSUIPCConnected;
-    static bool cRun;
-
-	bool simIs833Capable;
-	bool simIsXPlane;
-
-    DWORD cCom1Freq;
-    DWORD cCom1Sby;
-    DWORD cCom2Freq;
-    DWORD cCom2Sby;
-    BYTE cSelectedCom;
-    WORD cWoW;
-	DWORD cLatitude;
-	DWORD cLongitude;
-	DWORD cCom1Freq833;
-	DWORD cCom1Sby833;
-	DWORD cCom2Freq833;
-	DWORD cCom2Sby833;
-	double cLat;
-	double cLon;
-
-	double currentLat;
-    double currentLon;
+    static std::atomic<bool> cFSUIPCConnected;
+    static std::atomic<bool> cRun;
+
+    // How often the worker is polling, and why, for display.
+    static std::atomic<int> cPollInterval;
+    static std::atomic<int> cPollMode;
+
+    std::shared_ptr<SimSource> source;
+    std::shared_ptr<SimRecorder> recorder;
+
+    PollScheduler scheduler;
+    std::chrono::steady_clock::time_point lastForced;
+
+    bool firstDisconnectedPass;
+    bool firstConnectedPass;
+
+    // What the sim said last time, to tell what's changed since.
+    SimSource::Snapshot last;
+
+    // Where we were the last time a position change fired.
+    double cLat;
+    double cLon;
 
     void (*callback)(SimComData);
 
-    BOOL checkConnection(DWORD*);
+    // Waits for the worker to be stopped.
+    std::mutex waitLock;
+    std::condition_variable wake;
+
+    PollTiming timing;
+
     void workerThread(void);
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
     
     std::thread* t1 = NULL;
 
 public:
 
-    FSUIPCWrapper(void (*cb)(SimComData));
+    FSUIPCWrapper(void (*cb)(SimComData), std::shared_ptr<SimSource> simSource, PollScheduler::Rates pollRates = PollScheduler::Rates());
     ~FSUIPCWrapper();
 
     bool isConnected() {
         return cFSUIPCConnected;
     };
 
-    BOOL FSUIPC_Read(DWORD dwOffset, DWORD dwSize, void* pDest);
-    BOOL FSUIPC_Write(DWORD dwOffset, DWORD dwSize, void* pSrc);
-    BOOL FSUIPC_Process();
+    int getPollInterval() {
+        return cPollInterval;
+    };
+
+    PollScheduler::Mode getPollMode() {
+        return PollScheduler::Mode(cPollMode.load());
+    };
+
+    const PollTiming& getTiming() {
+        return timing;
+    };
+
+    const char* getSourceName() {
+        return source->getName();
+    };
+
+    // Everything the source says is recorded from then on. It has to be set before polling starts.
+    void setRecorder(std::shared_ptr<SimRecorder> simRecorder) {
+        recorder = simRecorder;
+    };
+
     void start(void);
     void stop(void);
 
-	SimComData FSUIPCWrapper::getSimComData(bool blComChanged, bool blPosChange, bool blOtherChanged);
+    // Reads the source once, calling back if anything's changed, and says how long to wait before the next
+    // time. The worker thread calls this in a loop - anything else driving it (a headless run, say) mustn't
+    // also start the worker.
+    std::chrono::milliseconds poll(void);
+
+	SimComData getSimComData(bool blComChanged, bool blPosChange, bool blOtherChanged);
 
     static std::string toString(FSUIPCWrapper::SimComData scd);
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include "OffsetPlan.h"
+#include "SimSource.h"
+
+// Turning FSUIPC's answers into a snapshot, kept apart from FsuipcSource so that it can be built and checked
+// without windows.h and the library.
+
+// The 25KHz radios give the middle four digits, in BCD.
+inline int decodeFsuipcBcd(uint16_t bcd)
+{
+    int retValue = 100000 + 10000 * ((bcd & 0xf000) >> 12) + 1000 * ((bcd & 0x0f00) >> 8) + 100 * ((bcd & 0x00f0) >> 4) + 10 * (bcd & 0x000f);
+
+    // If it's a 25KHz frequency, then we might need to add the last digit.
+    if (retValue % 50 == 20) retValue += 5;
+
+    return retValue;
+}
+
+// Decodes the plan, bound to its answers, given the versions FSUIPC reported when it was opened.
+inline void decodeFsuipcSnapshot(const SimComOffsets::Plan& plan, uint32_t fsuipcVersion, uint32_t fsVersion, SimSource::Snapshot& snapshot)
+{
+    using namespace SimComOffsets;
+
+    // This is a kluge because XPUIPC doesn't report the correct channel and the config file that comes with it doesn't seem to work as advertised.
+    // Look for a FSUIPC_Version with an most significant half word of 0x50000000 AND an FS Version of 8 (FSX).
+    // FSUIPC 5 is specific to P3D which has an FS version of 10.
+    bool simIsXPlane = (fsVersion == 8) && (fsuipcVersion & 0xffff0000) == 0x50000000;
+
+    // Depending if we're working on a 25KHz only radio or an 8.333KHz radio...
+    snapshot.is833 = simIsXPlane;
+
+    if (!snapshot.is833)
+    {
+        snapshot.com1 = decodeFsuipcBcd(plan.get<Com1Bcd>());
+        snapshot.com1Sby = decodeFsuipcBcd(plan.get<Com1SbyBcd>());
+        snapshot.com2 = decodeFsuipcBcd(plan.get<Com2Bcd>());
+        snapshot.com2Sby = decodeFsuipcBcd(plan.get<Com2SbyBcd>());
+    }
+    else
+    {
+        // No fancy stuff here (yet) - just pull the latest values.
+        snapshot.com1 = (int)(0.001 * plan.get<Com1Hz>());
+        snapshot.com1Sby = (int)(0.001 * plan.get<Com1SbyHz>());
+        snapshot.com2 = (int)(0.001 * plan.get<Com2Hz>());
+        snapshot.com2Sby = (int)(0.001 * plan.get<Com2SbyHz>());
+    }
+
+    uint8_t radioSwitch = plan.get<RadioSwitch>();
+
+    if (simIsXPlane)
+        snapshot.selectedCom = SimSource::ComRadio(((radioSwitch & 0x80) ? SimSource::None : SimSource::Com1) + ((radioSwitch & 0x40) ? SimSource::None : SimSource::Com2));
+    else
+        snapshot.selectedCom = SimSource::ComRadio(((radioSwitch & 0x80) ? SimSource::Com1 : SimSource::None) + ((radioSwitch & 0x40) ? SimSource::Com2 : SimSource::None));
+
+    snapshot.onGround = (plan.get<OnGround>() != 0);
+
+    snapshot.lat = double(plan.get<Latitude>()) * 90.0 / (10001750.0 * 65536.0 * 65536.0);
+    snapshot.lon = double(plan.get<Longitude>()) * 360.0 / (65536.0 * 65536.0 * 65536.0 * 65536.0);
+}
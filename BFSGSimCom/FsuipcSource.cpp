@@ -0,0 +1,135 @@
+#include "FsuipcSource.h"
+#include "FsuipcDecode.h"
+
+FsuipcSource::FsuipcSource() :
+	mConnected(false)
+{
+}
+
+FsuipcSource::~FsuipcSource()
+{
+	close();
+}
+
+// Returns true if connected, and false if not...
+bool FsuipcSource::open(void)
+{
+	if (!mConnected)
+	{
+		DWORD dwResult = FSUIPC_ERR_OK;
+
+		try
+		{
+			BOOL retValue = ::FSUIPC_Open(SIM_ANY, &dwResult);
+			mConnected = (retValue != FALSE) || (dwResult == FSUIPC_ERR_OPEN);
+		}
+		catch (...)
+		{
+			mConnected = false;
+		}
+	}
+
+	return mConnected;
+}
+
+bool FsuipcSource::read(Snapshot& snapshot)
+{
+	// Nowhere to copy the answers to - they're read where they are once processed.
+	if (!mPlan.queue([this](uint32_t offset, uint32_t size) { return FSUIPC_Read(offset, size, NULL) != FALSE; }))
+	{
+		// Whatever was queued before it would go with the next poll's reads and be taken for theirs, so it's
+		// sent now and the answers forgotten.
+		DWORD dwResult;
+
+		try
+		{
+			::FSUIPC_Process(&dwResult);
+		}
+		catch (...)
+		{
+		}
+
+		return false;
+	}
+
+	if (!FSUIPC_Process()) return false;
+
+	bool bound = mPlan.bind([](size_t read, uint32_t size) -> const uint8_t*
+	{
+		DWORD dwSize = 0;
+		const BYTE* pReply = ::FSUIPC_Reply(DWORD(read), &dwSize);
+
+		return (dwSize == size) ? pReply : NULL;
+	});
+
+	if (!bound) return false;
+
+	decodeFsuipcSnapshot(mPlan, FSUIPC_Version, FSUIPC_FS_Version, snapshot);
+
+	return true;
+}
+
+void FsuipcSource::close(void)
+{
+	// There's no harm in calling this whether FSUIPC is open or not.
+	::FSUIPC_Close();
+
+	mConnected = false;
+}
+
+BOOL FsuipcSource::FSUIPC_Read(DWORD dwOffset, DWORD dwSize, void* pDest)
+{
+	BOOL retValue = 0;
+	DWORD dwResult = FSUIPC_ERR_OK;
+
+	try
+	{
+		retValue = ::FSUIPC_Read(dwOffset, dwSize, pDest, &dwResult);
+	}
+	catch (...)
+	{
+		retValue = FALSE;
+	}
+
+	mConnected = (dwResult == FSUIPC_ERR_OK);
+
+	return retValue;
+}
+
+BOOL FsuipcSource::FSUIPC_Write(DWORD dwOffset, DWORD dwSize, void* pSrc)
+{
+	BOOL retValue = 0;
+	DWORD dwResult;
+
+	try
+	{
+		retValue = ::FSUIPC_Write(dwOffset, dwSize, pSrc, &dwResult);
+	}
+	catch (...)
+	{
+		retValue = FALSE;
+	}
+
+	mConnected = (dwResult != FSUIPC_ERR_NOTOPEN);
+
+	return retValue;
+}
+
+BOOL FsuipcSource::FSUIPC_Process()
+{
+	BOOL retValue = 0;
+	DWORD dwResult = FSUIPC_ERR_NOTOPEN;
+
+	try
+	{
+		retValue = ::FSUIPC_Process(&dwResult);
+	}
+	catch (...)
+	{
+		retValue = FALSE;
+	}
+
+	mConnected = (dwResult == FSUIPC_ERR_OK);
+
+	return retValue;
+}
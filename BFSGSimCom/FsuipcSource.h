@@ -0,0 +1,32 @@
+#pragma once
+
+#include <windows.h>
+
+#include "FSUIPC_User.h"
+
+#include "SimSource.h"
+#include "OffsetPlan.h"
+
+// The sim as seen through FSUIPC (or XPUIPC, for X-Plane).
+class FsuipcSource : public SimSource
+{
+public:
+    FsuipcSource();
+    ~FsuipcSource();
+
+    bool open(void);
+    bool read(Snapshot&);
+    void close(void);
+    const char* getName(void) { return "FSUIPC"; };
+
+    BOOL FSUIPC_Write(DWORD dwOffset, DWORD dwSize, void* pSrc);
+
+private:
+    bool mConnected;
+
+    // The offsets are read in as few blocks as they'll go in, and decoded from where FSUIPC answers them.
+    SimComOffsets::Plan mPlan;
+
+    BOOL FSUIPC_Read(DWORD dwOffset, DWORD dwSize, void* pDest);
+    BOOL FSUIPC_Process();
+};
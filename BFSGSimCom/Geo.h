@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cmath>
+
+// Distances over the earth, kept apart from the channels so that anything needing one needn't bring in the
+// database and the plugin with it.
+
+// The approximate radius of the earth in nautical miles.
+static const double EARTH_RADIUS_NM = 3437.746;
+
+#define DEG2RAD(degrees) ((degrees) * 0.01745327) // degrees * pi over 180
+
+inline double getDistanceBetweenLatLonInNm(double lat1, double lon1, double lat2, double lon2)
+{
+    // convert lat1 and lat2 into radians now, to avoid doing it twice below
+    double lat1rad = DEG2RAD(lat1);
+    double lat2rad = DEG2RAD(lat2);
+
+    // apply the spherical law of cosines to our latitudes and longitudes, and set the result appropriately
+    return acos(sin(lat1rad) * sin(lat2rad) + cos(lat1rad) * cos(lat2rad) * cos(DEG2RAD(lon2) - DEG2RAD(lon1))) * EARTH_RADIUS_NM;
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+
+#include "GeoIndex.h"
+
+using namespace std;
+
+// Same radius as getDistanceBetweenLatLonInNm.
+static const double aEarthRadiusNm = 3437.746;
+static const double aDeg2Rad = 3.14159265358979323846 / 180.0;
+
+GeoIndex::GeoIndex(const vector<Location>& locations)
+{
+    mPoints.resize(locations.size());
+    mBoxes.resize(locations.size());
+
+    for (size_t i = 0; i < locations.size(); i++)
+    {
+        toXYZ(locations[i].lat, locations[i].lon, mPoints[i].xyz);
+        mPoints[i].channel = locations[i].channel;
+    }
+
+    build(0, mPoints.size(), 0);
+}
+
+void GeoIndex::build(size_t lo, size_t hi, int axis)
+{
+    if (lo >= hi) return;
+
+    size_t mid = lo + (hi - lo) / 2;
+    nth_element(mPoints.begin() + lo, mPoints.begin() + mid, mPoints.begin() + hi,
+        [axis](const Point& a, const Point& b) { return a.xyz[axis] < b.xyz[axis]; });
+
+    build(lo, mid, (axis + 1) % 3);
+    build(mid + 1, hi, (axis + 1) % 3);
+
+    Box& box = mBoxes[mid];
+    for (int i = 0; i < 3; i++)
+    {
+        box.min[i] = box.max[i] = mPoints[mid].xyz[i];
+
+        if (lo < mid)
+        {
+            const Box& left = mBoxes[lo + (mid - lo) / 2];
+            box.min[i] = min(box.min[i], left.min[i]);
+            box.max[i] = max(box.max[i], left.max[i]);
+        }
+
+        if (mid + 1 < hi)
+        {
+            const Box& right = mBoxes[mid + 1 + (hi - mid - 1) / 2];
+            box.min[i] = min(box.min[i], right.min[i]);
+            box.max[i] = max(box.max[i], right.max[i]);
+        }
+    }
+}
+
+void GeoIndex::toXYZ(double lat, double lon, double xyz[3])
+{
+    xyz[0] = cos(lat * aDeg2Rad) * cos(lon * aDeg2Rad);
+    xyz[1] = cos(lat * aDeg2Rad) * sin(lon * aDeg2Rad);
+    xyz[2] = sin(lat * aDeg2Rad);
+}
+
+// The great circle distance for a squared straight line distance between two points on the unit sphere.
+double GeoIndex::toNm(double chord2)
+{
+    double half = sqrt(chord2) / 2.0;
+    return 2.0 * asin(min(half, 1.0)) * aEarthRadiusNm;
+}
+
+GeoIndex::Search::Search(const GeoIndex& index, double lat, double lon) :
+    mIndex(index)
+{
+    toXYZ(lat, lon, mXYZ);
+    push(0, index.mPoints.size());
+}
+
+// Queues a range of the tree, at the closest any point in it could be.
+void GeoIndex::Search::push(size_t lo, size_t hi)
+{
+    if (lo >= hi) return;
+
+    const Box& box = mIndex.mBoxes[lo + (hi - lo) / 2];
+    Step step = { 0.0, false, lo, hi };
+
+    for (int i = 0; i < 3; i++)
+    {
+        double d = 0.0;
+        if (mXYZ[i] < box.min[i]) d = box.min[i] - mXYZ[i];
+        else if (mXYZ[i] > box.max[i]) d = mXYZ[i] - box.max[i];
+
+        step.chord2 += d * d;
+    }
+
+    mSteps.push(step);
+}
+
+bool GeoIndex::Search::next(uint64& channel, double& nm)
+{
+    while (!mSteps.empty())
+    {
+        Step step = mSteps.top();
+        mSteps.pop();
+
+        size_t mid = step.lo + (step.hi - step.lo) / 2;
+
+        if (step.point)
+        {
+            channel = mIndex.mPoints[mid].channel;
+            nm = toNm(step.chord2);
+            return true;
+        }
+
+        // Split the range into its middle point and the ranges either side.
+        Step point = { 0.0, true, step.lo, step.hi };
+        for (int i = 0; i < 3; i++)
+        {
+            double d = mIndex.mPoints[mid].xyz[i] - mXYZ[i];
+            point.chord2 += d * d;
+        }
+
+        mSteps.push(point);
+        push(step.lo, mid);
+        push(mid + 1, step.hi);
+    }
+
+    return false;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+
+using namespace ::std;
+
+// A small k-d tree over channel locations, for finding the channels closest to a point in order.
+//
+// Locations are held as points on the unit sphere, where the straight line distance between two points
+// goes up with the great circle distance, so there's no trouble at the poles or the date line.
+class GeoIndex
+{
+public:
+    struct Location
+    {
+        uint64 channel;
+        double lat;
+        double lon;
+    };
+
+    GeoIndex(const vector<Location>&);
+
+    size_t size(void) const { return mPoints.size(); };
+
+    // Hands out the channels nearest first. Each comes with how far away it is, in nautical miles.
+    class Search
+    {
+    public:
+        Search(const GeoIndex&, double lat, double lon);
+
+        bool next(uint64& channel, double& nm);
+
+    private:
+        struct Step
+        {
+            double chord2;
+            bool point;
+            size_t lo;
+            size_t hi;
+
+            bool operator>(const Step& other) const { return chord2 > other.chord2; };
+        };
+
+        const GeoIndex& mIndex;
+        double mXYZ[3];
+        priority_queue<Step, vector<Step>, greater<Step>> mSteps;
+
+        void push(size_t lo, size_t hi);
+    };
+
+private:
+    struct Point
+    {
+        double xyz[3];
+        uint64 channel;
+    };
+
+    struct Box
+    {
+        double min[3];
+        double max[3];
+    };
+
+    // The tree is kept in one array - each range's middle point splits it, and holds the box around the range.
+    vector<Point> mPoints;
+    vector<Box> mBoxes;
+
+    void build(size_t lo, size_t hi, int axis);
+
+    static void toXYZ(double lat, double lon, double xyz[3]);
+    static double toNm(double chord2);
+};
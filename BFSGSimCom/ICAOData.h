@@ -3,7 +3,7 @@
 #include <string>
 #include <vector>
 
-#include <SQLiteCpp\Database.h>
+#include <SQLiteCpp/Database.h>
 
 using namespace ::std;
 
@@ -29,7 +29,7 @@ public:
         double lat;
         double lon;
 
-        ICAOData::Station::Station(string strIdent, string strType, int iFrequency, string strName, double dLat, double dLon);
+        Station(string strIdent, string strType, int iFrequency, string strName, double dLat, double dLon);
 
     private:
 
@@ -37,7 +37,7 @@ public:
 
     //vector<struct ICAOData::Station> ICAOData::getAirportData(string strICAO);
 	//vector<struct ICAOData::Station> ICAOData::getStationData(string strICAO, string strType);
-	vector<struct ICAOData::Station> ICAOData::getStationData(string strICAOType);
+	vector<struct ICAOData::Station> getStationData(string strICAOType);
 
     ICAOData();
     ~ICAOData();
@@ -0,0 +1,91 @@
+#include <cmath>
+
+#include "InRangeTracker.h"
+#include "Geo.h"
+
+using namespace std;
+
+const double InRangeTracker::SLACK_NM = 0.01;
+
+InRangeTracker::InRangeTracker(double cellNm)
+{
+    mCell = cellNm;
+    mAnchored = false;
+    mVersion = 0;
+    mRoot = TuningTable::NO_ROOT;
+    mLat = 0.0;
+    mLon = 0.0;
+    mAnchors = 0;
+}
+
+void InRangeTracker::update(const ChannelIndex& index, const TuningTable& tuning, double lat, double lon)
+{
+    if (mAnchored && mVersion == index.getVersion() && mRoot == tuning.getRoot())
+    {
+        double moved = getDistanceBetweenLatLonInNm(mLat, mLon, lat, lon);
+
+        // Hardly having moved at all can come out as NaN.
+        if (isnan(moved) || moved <= mCell) return;
+    }
+
+    anchor(index, tuning, lat, lon);
+}
+
+// Sorts every located channel under the root into in range, out of range, or too close to call.
+void InRangeTracker::anchor(const ChannelIndex& index, const TuningTable& tuning, double lat, double lon)
+{
+    enum Status { IN_RANGE, OUT_OF_RANGE, BOUNDARY };
+    unordered_map<uint64, Status> status;
+
+    mInRange.clear();
+    mBoundary.clear();
+
+    for (const auto& candidates : tuning.getAllCandidates())
+    {
+        for (uint64 ch : candidates.second)
+        {
+            auto known = status.find(ch);
+            if (known == status.end())
+            {
+                const ChannelIndex::Channel* channel = index.getChannel(ch);
+
+                // Channels without a location are always in range, and are kept by the tuning table.
+                if (channel == NULL || !channel->hasLatLon) continue;
+
+                double d = getDistanceBetweenLatLonInNm(channel->lat, channel->lon, lat, lon);
+                Status s = BOUNDARY;
+
+                if (!isnan(d) && d + mCell + SLACK_NM < channel->range) s = IN_RANGE;
+                else if (!isnan(d) && d - mCell - SLACK_NM > channel->range) s = OUT_OF_RANGE;
+
+                known = status.insert(make_pair(ch, s)).first;
+            }
+
+            if (known->second == IN_RANGE) mInRange[candidates.first].push_back(ch);
+            else if (known->second == BOUNDARY) mBoundary[candidates.first].push_back(ch);
+        }
+    }
+
+    mAnchored = true;
+    mVersion = index.getVersion();
+    mRoot = tuning.getRoot();
+    mLat = lat;
+    mLon = lon;
+    mAnchors++;
+}
+
+const vector<uint64>& InRangeTracker::getInRange(uint64 frequencyKey) const
+{
+    static const vector<uint64> none;
+
+    auto channels = mInRange.find(frequencyKey);
+    return (channels == mInRange.end()) ? none : channels->second;
+}
+
+const vector<uint64>& InRangeTracker::getBoundary(uint64 frequencyKey) const
+{
+    static const vector<uint64> none;
+
+    auto channels = mBoundary.find(frequencyKey);
+    return (channels == mBoundary.end()) ? none : channels->second;
+}
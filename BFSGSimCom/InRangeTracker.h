@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+
+#include "ChannelIndex.h"
+
+using namespace ::std;
+
+// Keeps track of which channels under the tuning root have the aircraft within their range.
+//
+// The channels are sorted out once for an anchor position. Any channel further than the cell size from the
+// edge of its range can't change while the aircraft stays within the cell size of the anchor, so only the
+// few close to their edge need looking at on each decision. It's sorted out again when the aircraft leaves
+// the cell or the channels change.
+class InRangeTracker
+{
+public:
+    InRangeTracker(double cellNm = 5.0);
+
+    void update(const ChannelIndex&, const TuningTable&, double lat, double lon);
+
+    // Located channels which are certainly in range, and those which might be either.
+    const vector<uint64>& getInRange(uint64 frequencyKey) const;
+    const vector<uint64>& getBoundary(uint64 frequencyKey) const;
+
+    uint64 getAnchors(void) const { return mAnchors; };
+
+private:
+    // The distance formula isn't exact, so leave a little room either side.
+    static const double SLACK_NM;
+
+    double mCell;
+    bool mAnchored;
+    uint64 mVersion;
+    uint64 mRoot;
+    double mLat;
+    double mLon;
+    uint64 mAnchors;
+
+    unordered_map<uint64, vector<uint64>> mInRange;
+    unordered_map<uint64, vector<uint64>> mBoundary;
+
+    void anchor(const ChannelIndex&, const TuningTable&, double lat, double lon);
+};
@@ -0,0 +1,82 @@
+#include <sstream>
+
+#include "LatencyHistogram.h"
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(chrono::steady_clock::duration duration)
+{
+    int64_t us = chrono::duration_cast<chrono::microseconds>(duration).count();
+    if (us < 0) us = 0;
+
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && uint64_t(us) >= bucketLimitUs(bucket))
+        bucket++;
+
+    mBuckets[bucket].fetch_add(1, memory_order_relaxed);
+    mTotalUs.fetch_add(uint64_t(us), memory_order_relaxed);
+
+    // Only the one thread records, so there's no race to lose here.
+    if (uint64_t(us) > mMaxUs.load(memory_order_relaxed))
+        mMaxUs.store(uint64_t(us), memory_order_relaxed);
+}
+
+void LatencyHistogram::reset(void)
+{
+    for (int i = 0; i < BUCKETS; i++)
+        mBuckets[i].store(0, memory_order_relaxed);
+
+    mTotalUs.store(0, memory_order_relaxed);
+    mMaxUs.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getCount(void) const
+{
+    uint64_t retValue = 0;
+
+    for (int i = 0; i < BUCKETS; i++)
+        retValue += mBuckets[i].load(memory_order_relaxed);
+
+    return retValue;
+}
+
+uint64_t LatencyHistogram::getMeanUs(void) const
+{
+    uint64_t count = getCount();
+
+    return (count == 0) ? 0 : mTotalUs.load(memory_order_relaxed) / count;
+}
+
+uint64_t LatencyHistogram::getPercentileUs(double fraction) const
+{
+    uint64_t count = getCount();
+    if (count == 0) return 0;
+
+    uint64_t wanted = uint64_t(fraction * count + 0.5);
+    if (wanted == 0) wanted = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += mBuckets[i].load(memory_order_relaxed);
+        if (seen >= wanted) return bucketLimitUs(i);
+    }
+
+    return bucketLimitUs(BUCKETS - 1);
+}
+
+string LatencyHistogram::toString(void) const
+{
+    ostringstream ostr;
+
+    ostr << "n=" << getCount() << " mean=" << getMeanUs() << "us";
+    ostr << " p50<" << getPercentileUs(0.5) << "us p99<" << getPercentileUs(0.99) << "us";
+    ostr << " max=" << getMaxUs() << "us";
+
+    return ostr.str();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+using namespace ::std;
+
+// Counts durations into power of two buckets of microseconds - under 1us, under 2us, under 4us and so on
+// up to about 35 minutes. One thread records, any thread can read; the counts are only ever approximately
+// consistent with each other while it's being recorded into, which is plenty for seeing where time goes.
+class LatencyHistogram
+{
+public:
+    static const int BUCKETS = 32;
+
+    LatencyHistogram();
+
+    void record(chrono::steady_clock::duration duration);
+    void reset(void);
+
+    uint64_t getCount(void) const;
+    uint64_t getMaxUs(void) const { return mMaxUs.load(memory_order_relaxed); };
+    uint64_t getMeanUs(void) const;
+
+    // The upper bound of the bucket the given fraction of durations fall within.
+    uint64_t getPercentileUs(double fraction) const;
+
+    // "n=1234 mean=210us p50<256us p99<1024us max=3021us"
+    string toString(void) const;
+
+private:
+    atomic<uint64_t> mBuckets[BUCKETS];
+    atomic<uint64_t> mTotalUs;
+    atomic<uint64_t> mMaxUs;
+
+    static uint64_t bucketLimitUs(int bucket) { return uint64_t(1) << bucket; };
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <tuple>
+#include <utility>
+
+using namespace ::std;
+
+// The offsets we want from FSUIPC, gathered at compile time into the blocks they're read in.
+//
+// A field is a value at an offset. A plan is given its fields in the order of their offsets, and works out
+// from them the blocks to read - runs of offsets read as one request. It queues one read per block with
+// nowhere to copy it to, and once the reads are processed it's pointed at each block's answer where it lies
+// in the shared memory. Fields are then read straight out of that, so there's no buffer between FSUIPC and
+// the decoder, and a field that isn't in the plan doesn't compile.
+
+// Each read request to FSUIPC carries a 16 byte header, so a gap up to that size is cheaper to read through
+// than to make another request for what's after it.
+static const uint32_t OFFSET_REQUEST_OVERHEAD = 16;
+
+template<uint32_t Offset, class T> struct OffsetField
+{
+    typedef T Type;
+
+    static const uint32_t OFFSET = Offset;
+    static const uint32_t END = Offset + uint32_t(sizeof(T));
+};
+
+// Where the plan's blocks have got to by the Index'th field - which block that field is in, where the block
+// starts, and where it ends so far. Each field goes in the block before it if it's near enough to its end.
+template<size_t Index, class... Fields> struct OffsetRun
+{
+    typedef typename tuple_element<Index, tuple<Fields...>>::type Field;
+    typedef OffsetRun<Index - 1, Fields...> Previous;
+
+    static_assert(Field::OFFSET >= Previous::Field::OFFSET, "The fields must be listed in the order of their offsets");
+
+    static const bool STARTS = Field::OFFSET > Previous::END + OFFSET_REQUEST_OVERHEAD;
+
+    static const size_t BLOCK = Previous::BLOCK + (STARTS ? 1 : 0);
+    static const uint32_t START = STARTS ? Field::OFFSET : Previous::START;
+    static const uint32_t END = (STARTS || Field::END > Previous::END) ? Field::END : Previous::END;
+};
+
+template<class... Fields> struct OffsetRun<0, Fields...>
+{
+    typedef typename tuple_element<0, tuple<Fields...>>::type Field;
+
+    static const size_t BLOCK = 0;
+    static const uint32_t START = Field::OFFSET;
+    static const uint32_t END = Field::END;
+};
+
+// The runs for every field, as a table to go through when the plan's queued and bound.
+struct OffsetSpan
+{
+    size_t block;
+    uint32_t start;
+    uint32_t end;
+};
+
+template<class Indices, class... Fields> struct OffsetSpans;
+
+template<size_t... Index, class... Fields> struct OffsetSpans<index_sequence<Index...>, Fields...>
+{
+    static const OffsetSpan aSpans[sizeof...(Index)];
+};
+
+template<size_t... Index, class... Fields> const OffsetSpan OffsetSpans<index_sequence<Index...>, Fields...>::aSpans[] =
+{
+    { OffsetRun<Index, Fields...>::BLOCK, OffsetRun<Index, Fields...>::START, OffsetRun<Index, Fields...>::END }...
+};
+
+template<class... Fields> class OffsetPlan
+{
+public:
+    static const size_t FIELDS = sizeof...(Fields);
+    static const size_t BLOCKS = OffsetRun<FIELDS - 1, Fields...>::BLOCK + 1;
+
+    // Queues a read; false if it couldn't be.
+    typedef function<bool(uint32_t offset, uint32_t size)> Reader;
+
+    // Where the answer to the given read is, once processed, or null if it's missing or not the size asked for.
+    typedef function<const uint8_t*(size_t read, uint32_t size)> Locator;
+
+    OffsetPlan()
+    {
+        for (size_t i = 0; i < BLOCKS; i++) mReplies[i] = nullptr;
+    }
+
+    // Queues one read for each block, in order. False as soon as one couldn't be queued, as the answers
+    // would no longer line up with the blocks.
+    bool queue(Reader read)
+    {
+        for (size_t i = 0; i < FIELDS; i++)
+        {
+            // A block's last field is where it ends, and where it's read from.
+            if (!isLast(i)) continue;
+
+            if (!read(Spans::aSpans[i].start, Spans::aSpans[i].end - Spans::aSpans[i].start)) return false;
+        }
+
+        return true;
+    }
+
+    // Finds the answers to the reads just processed. The fields can only be read if they're all there, and only
+    // until FSUIPC is next asked for anything.
+    bool bind(Locator locate)
+    {
+        bool retValue = true;
+
+        for (size_t i = 0; i < FIELDS; i++)
+        {
+            if (!isLast(i)) continue;
+
+            size_t block = Spans::aSpans[i].block;
+
+            mReplies[block] = locate(block, Spans::aSpans[i].end - Spans::aSpans[i].start);
+            if (mReplies[block] == nullptr) retValue = false;
+        }
+
+        return retValue;
+    }
+
+    template<class Field> typename Field::Type get(void) const
+    {
+        typedef OffsetRun<indexOf<Field, Fields...>::value, Fields...> Run;
+        typedef typename Field::Type T;
+
+        // The answers follow each other's headers, so a field needn't be aligned - copying it out is as cheap
+        // as a load where it is, and safe where it isn't.
+        T retValue;
+        memcpy(&retValue, mReplies[Run::BLOCK] + (Field::OFFSET - Run::START), sizeof(T));
+
+        return retValue;
+    }
+
+    // The bytes sent for each poll, headers included.
+    static uint32_t getPayload(void)
+    {
+        uint32_t retValue = 0;
+
+        for (size_t i = 0; i < FIELDS; i++)
+        {
+            if (isLast(i)) retValue += Spans::aSpans[i].end - Spans::aSpans[i].start + OFFSET_REQUEST_OVERHEAD;
+        }
+
+        return retValue;
+    }
+
+private:
+    typedef OffsetSpans<make_index_sequence<FIELDS>, Fields...> Spans;
+
+    // Where a field is in the plan. A field that isn't in it doesn't compile.
+    template<class Field, class... List> struct indexOf;
+    template<class Field, class... Rest> struct indexOf<Field, Field, Rest...> { static const size_t value = 0; };
+    template<class Field, class First, class... Rest> struct indexOf<Field, First, Rest...> { static const size_t value = 1 + indexOf<Field, Rest...>::value; };
+
+    const uint8_t* mReplies[BLOCKS];
+
+    static bool isLast(size_t field) { return field + 1 == FIELDS || Spans::aSpans[field + 1].block != Spans::aSpans[field].block; }
+};
+
+// Everything SimCom polls for, in the order of their offsets. They come to five blocks: com1, on the ground,
+// the position, the 8.33 frequencies, and the rest of the radios.
+namespace SimComOffsets
+{
+    typedef OffsetField<0x034E, uint16_t> Com1Bcd;
+    typedef OffsetField<0x0366, uint16_t> OnGround;
+    typedef OffsetField<0x0560, int64_t> Latitude;
+    typedef OffsetField<0x0568, int64_t> Longitude;
+    typedef OffsetField<0x05C4, uint32_t> Com1Hz;
+    typedef OffsetField<0x05C8, uint32_t> Com2Hz;
+    typedef OffsetField<0x05CC, uint32_t> Com1SbyHz;
+    typedef OffsetField<0x05D0, uint32_t> Com2SbyHz;
+    typedef OffsetField<0x3118, uint16_t> Com2Bcd;
+    typedef OffsetField<0x311A, uint16_t> Com1SbyBcd;
+    typedef OffsetField<0x311C, uint16_t> Com2SbyBcd;
+    typedef OffsetField<0x3122, uint8_t> RadioSwitch;
+
+    typedef OffsetPlan<Com1Bcd, OnGround, Latitude, Longitude, Com1Hz, Com2Hz, Com1SbyHz, Com2SbyHz, Com2Bcd, Com1SbyBcd, Com2SbyBcd, RadioSwitch> Plan;
+}
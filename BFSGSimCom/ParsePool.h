@@ -0,0 +1,230 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace ::std;
+
+// The worker threads every ParsePool in the process runs its jobs on. It's only there while something is using
+// it, so the threads are gone once the last server connection has been.
+class WorkerPool
+{
+public:
+    typedef function<void(void)> Task;
+
+    // Parsing only happens in bursts when connecting, so a few threads is plenty however many cores there are.
+    static const unsigned int MAX_THREADS = 4;
+
+    static shared_ptr<WorkerPool> shared(void)
+    {
+        static mutex lock;
+        static weak_ptr<WorkerPool> pool;
+
+        lock_guard<mutex> guard(lock);
+
+        shared_ptr<WorkerPool> retValue = pool.lock();
+        if (retValue == nullptr)
+        {
+            unsigned int threads = thread::hardware_concurrency();
+            if (threads == 0) threads = 1;
+            if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+            retValue = make_shared<WorkerPool>(threads);
+            pool = retValue;
+        }
+
+        return retValue;
+    }
+
+    WorkerPool(unsigned int threads) : mStop(false)
+    {
+        for (unsigned int i = 0; i < threads; i++)
+            mWorkers.push_back(thread(&WorkerPool::run, this));
+    }
+
+    ~WorkerPool()
+    {
+        {
+            lock_guard<mutex> lock(mLock);
+            mStop = true;
+        }
+
+        mWork.notify_all();
+        for (thread& worker : mWorkers) worker.join();
+    }
+
+    // Tasks mustn't throw - anything that can has to catch it itself.
+    void post(Task task)
+    {
+        {
+            lock_guard<mutex> lock(mLock);
+            mTasks.push_back(task);
+        }
+
+        mWork.notify_one();
+    }
+
+private:
+    mutex mLock;
+    condition_variable mWork;
+    deque<Task> mTasks;
+    bool mStop;
+
+    vector<thread> mWorkers;
+
+    void run(void)
+    {
+        unique_lock<mutex> lock(mLock);
+
+        while (true)
+        {
+            mWork.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+            if (mTasks.empty()) return;
+
+            Task task = mTasks.front();
+            mTasks.pop_front();
+
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+};
+
+// Runs independent jobs on the shared worker threads, and hands their results to a single commit function
+// in the order the jobs were submitted.
+//
+// Whichever worker finishes the next result due becomes the committer, and passes on every result that's
+// ready in order as one batch. Only one batch is ever being committed at a time, so the commit function
+// never needs to worry about another commit running alongside it.
+//
+// A job that throws still gets a result, made from what it threw by the failure function it was submitted
+// with, so that it's committed in its turn like any other.
+template <class R>
+class ParsePool
+{
+public:
+    typedef function<R(void)> Job;
+    typedef function<R(const string& error)> Failure;
+    typedef function<void(vector<R>&)> Commit;
+
+    ParsePool(Commit commit) :
+        mCommit(commit),
+        mSubmitted(0),
+        mCommitted(0),
+        mRunning(0),
+        mCommitting(false),
+        mWorkers(WorkerPool::shared())
+    {
+    }
+
+    // The workers are shared, so they can't just be stopped - anything of ours they've still to run is
+    // waited for instead.
+    ~ParsePool()
+    {
+        unique_lock<mutex> lock(mLock);
+        mIdle.wait(lock, [this]() { return mRunning == 0; });
+    }
+
+    void submit(Job job, Failure failure)
+    {
+        uint64_t index;
+
+        {
+            lock_guard<mutex> lock(mLock);
+            index = mSubmitted++;
+            mRunning++;
+        }
+
+        mWorkers->post([this, index, job, failure]() { run(index, job, failure); });
+    }
+
+    // Waits until everything submitted so far has been committed.
+    void wait(void)
+    {
+        unique_lock<mutex> lock(mLock);
+        uint64_t submitted = mSubmitted;
+
+        mIdle.wait(lock, [this, submitted]() { return mCommitted >= submitted && !mCommitting; });
+    }
+
+private:
+    Commit mCommit;
+
+    mutex mLock;
+    condition_variable mIdle;
+
+    map<uint64_t, R> mDone;
+    uint64_t mSubmitted;
+    uint64_t mCommitted;
+    uint64_t mRunning;
+    bool mCommitting;
+
+    shared_ptr<WorkerPool> mWorkers;
+
+    static R attempt(const Job& job, const Failure& failure)
+    {
+        try
+        {
+            return job();
+        }
+        catch (exception& e)
+        {
+            return failure(e.what());
+        }
+        catch (...)
+        {
+            return failure("unknown error");
+        }
+    }
+
+    void run(uint64_t index, const Job& job, const Failure& failure)
+    {
+        R result = attempt(job, failure);
+
+        unique_lock<mutex> lock(mLock);
+
+        mDone.insert(make_pair(index, result));
+
+        // Someone else is already committing, and will pick this up if it's next.
+        if (!mCommitting)
+        {
+            mCommitting = true;
+            while (!mDone.empty() && mDone.begin()->first == mCommitted)
+            {
+                vector<R> batch;
+                while (!mDone.empty() && mDone.begin()->first == mCommitted)
+                {
+                    batch.push_back(mDone.begin()->second);
+                    mDone.erase(mDone.begin());
+                    mCommitted++;
+                }
+
+                lock.unlock();
+                try
+                {
+                    mCommit(batch);
+                }
+                catch (...)
+                {
+                    // The commit function deals with its own errors - this only stops the worker going with it.
+                }
+                lock.lock();
+            }
+            mCommitting = false;
+        }
+
+        mRunning--;
+        mIdle.notify_all();
+    }
+};
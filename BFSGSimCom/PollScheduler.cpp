@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "PollScheduler.h"
+
+using namespace std;
+
+PollScheduler::Rates::Rates() :
+    burst(20),
+    normal(100),
+    cruise(250),
+    backoff(5000),
+    burstFor(2000),
+    cruiseAfter(30000)
+{
+}
+
+PollScheduler::PollScheduler(const Rates& rates) :
+    mRates(rates),
+    mMode(POLL_NORMAL),
+    mInterval(rates.normal),
+    mLastRadioChange(chrono::steady_clock::now())
+{
+    // A rate of nothing would have us spinning.
+    mRates.burst = max(mRates.burst, chrono::milliseconds(1));
+    mRates.normal = max(mRates.normal, chrono::milliseconds(1));
+    mRates.cruise = max(mRates.cruise, chrono::milliseconds(1));
+    mRates.backoff = max(mRates.backoff, mRates.normal);
+    mInterval = mRates.normal;
+}
+
+chrono::milliseconds PollScheduler::next(bool connected, bool radioChanged, chrono::steady_clock::time_point now)
+{
+    if (!connected)
+    {
+        // Back off from the normal rate, doubling each time we still can't get through.
+        mInterval = (mMode == POLL_BACKOFF) ? min(mInterval * 2, mRates.backoff) : mRates.normal;
+        mMode = POLL_BACKOFF;
+
+        return mInterval;
+    }
+
+    // Coming back counts as a change, so whatever the radios are set to now is picked up quickly.
+    if (radioChanged || mMode == POLL_BACKOFF)
+        mLastRadioChange = now;
+
+    if (now - mLastRadioChange < mRates.burstFor)
+        mMode = POLL_BURST;
+    else if (now - mLastRadioChange < mRates.cruiseAfter)
+        mMode = POLL_NORMAL;
+    else
+        mMode = POLL_CRUISE;
+
+    switch (mMode)
+    {
+    case POLL_BURST:
+        mInterval = mRates.burst;
+        break;
+    case POLL_CRUISE:
+        mInterval = mRates.cruise;
+        break;
+    default:
+        mInterval = mRates.normal;
+    }
+
+    return mInterval;
+}
+
+const char* PollScheduler::toString(Mode mode)
+{
+    switch (mode)
+    {
+    case POLL_BURST:
+        return "burst";
+    case POLL_CRUISE:
+        return "cruise";
+    case POLL_BACKOFF:
+        return "backoff";
+    default:
+        return "normal";
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+
+using namespace ::std;
+
+// Decides how long to wait before polling the simulator again.
+//
+// A COM or selector change starts a burst of fast polls, so that turning a knob through several frequencies
+// is followed straight away. Once the radios have been left alone for a while the polls slow down to the
+// cruise rate. While the simulator can't be reached, the wait doubles each time up to the backoff limit, so
+// we aren't trying to open FSUIPC ten times a second all session.
+class PollScheduler
+{
+public:
+    enum Mode
+    {
+        POLL_BURST,
+        POLL_NORMAL,
+        POLL_CRUISE,
+        POLL_BACKOFF
+    };
+
+    struct Rates
+    {
+        chrono::milliseconds burst;
+        chrono::milliseconds normal;
+        chrono::milliseconds cruise;
+        chrono::milliseconds backoff;
+
+        // How long a burst lasts after the last radio change, and how long without one before we cruise.
+        chrono::milliseconds burstFor;
+        chrono::milliseconds cruiseAfter;
+
+        Rates();
+    };
+
+    PollScheduler(const Rates& rates = Rates());
+
+    chrono::milliseconds next(bool connected, bool radioChanged, chrono::steady_clock::time_point now = chrono::steady_clock::now());
+
+    Mode getMode(void) const { return mMode; };
+    chrono::milliseconds getInterval(void) const { return mInterval; };
+
+    static const char* toString(Mode mode);
+
+private:
+    Rates mRates;
+    Mode mMode;
+    chrono::milliseconds mInterval;
+    chrono::steady_clock::time_point mLastRadioChange;
+};
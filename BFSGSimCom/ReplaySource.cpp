@@ -0,0 +1,161 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "ReplaySource.h"
+#include "SimRecorder.h"
+
+using namespace std;
+
+// Reads a number stored in seven bit groups, failing if it runs off the end.
+static bool getValue(const vector<uint8_t>& data, size_t& pos, uint64_t& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= data.size()) return false;
+
+        uint8_t byte = data[pos++];
+        value |= uint64_t(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) return true;
+    }
+
+    return false;
+}
+
+static bool getSigned(const vector<uint8_t>& data, size_t& pos, int64_t& value)
+{
+    uint64_t zigzag;
+    if (!getValue(data, pos, zigzag)) return false;
+
+    value = int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+    return true;
+}
+
+ReplaySource::ReplaySource(double speed) :
+    mSpeed(speed),
+    mPlaying(false),
+    mNext(0)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+}
+
+bool ReplaySource::load(const string& path)
+{
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(SimRecorder::MAGIC)];
+    uint32_t version;
+
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, SimRecorder::MAGIC, sizeof(magic)) != 0) return false;
+    if (!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || version != SimRecorder::VERSION) return false;
+
+    vector<uint8_t> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    vector<Frame> frames;
+    Frame frame;
+    frame.t = 0.0;
+    int64_t lat = 0;
+    int64_t lon = 0;
+    uint64_t micros = 0;
+
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        uint8_t fields = data[pos++];
+        uint64_t delta;
+        int64_t value;
+
+        // Anything that doesn't decode is a record that was cut short, so the recording ends there.
+        if (!getValue(data, pos, delta)) break;
+        micros += delta;
+
+        bool ok = true;
+        if (ok && (fields & SimRecorder::FIELD_COM1)) { ok = getSigned(data, pos, value); frame.snapshot.com1 += int(value); }
+        if (ok && (fields & SimRecorder::FIELD_COM1SBY)) { ok = getSigned(data, pos, value); frame.snapshot.com1Sby += int(value); }
+        if (ok && (fields & SimRecorder::FIELD_COM2)) { ok = getSigned(data, pos, value); frame.snapshot.com2 += int(value); }
+        if (ok && (fields & SimRecorder::FIELD_COM2SBY)) { ok = getSigned(data, pos, value); frame.snapshot.com2Sby += int(value); }
+
+        if (ok && (fields & SimRecorder::FIELD_SWITCHES))
+        {
+            ok = (pos < data.size());
+            if (ok)
+            {
+                uint8_t switches = data[pos++];
+                frame.snapshot.selectedCom = ComRadio(switches & SimRecorder::SWITCHES_COM);
+                frame.snapshot.onGround = (switches & SimRecorder::SWITCHES_GROUND) != 0;
+                frame.snapshot.is833 = (switches & SimRecorder::SWITCHES_833) != 0;
+            }
+        }
+
+        if (ok && (fields & SimRecorder::FIELD_POSITION))
+        {
+            int64_t dLon = 0;
+            ok = getSigned(data, pos, value) && getSigned(data, pos, dLon);
+            if (!ok) break;
+
+            lat += value;
+            lon += dLon;
+            frame.snapshot.lat = lat / SimRecorder::POSITION_SCALE;
+            frame.snapshot.lon = lon / SimRecorder::POSITION_SCALE;
+        }
+
+        if (!ok) break;
+
+        frame.t = micros * 1e-6;
+        frame.connected = (fields & SimRecorder::FIELD_DISCONNECTED) == 0;
+        frames.push_back(frame);
+    }
+
+    mFrames.swap(frames);
+    mPlaying = false;
+    mNext = 0;
+
+    return true;
+}
+
+bool ReplaySource::open(void)
+{
+    if (!mPlaying && !mFrames.empty())
+    {
+        mPlaying = true;
+        mStarted = chrono::steady_clock::now();
+        mNext = 0;
+    }
+
+    return mPlaying;
+}
+
+bool ReplaySource::read(Snapshot& snapshot)
+{
+    if (!mPlaying) return false;
+
+    if (mSpeed <= 0.0)
+    {
+        if (mNext < mFrames.size()) mNext++;
+    }
+    else
+    {
+        double t = chrono::duration<double>(chrono::steady_clock::now() - mStarted).count() * mSpeed;
+
+        // Always at least the first, and once it's all played the last stays put.
+        if (mNext == 0) mNext = 1;
+        while (mNext < mFrames.size() && mFrames[mNext].t <= t)
+            mNext++;
+    }
+
+    const Frame& frame = mFrames[mNext - 1];
+    snapshot = frame.snapshot;
+
+    return frame.connected;
+}
+
+void ReplaySource::close(void)
+{
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "SimSource.h"
+
+using namespace ::std;
+
+// Plays back a flight recorded by SimRecorder, with the snapshots coming out at the times they went in.
+class ReplaySource : public SimSource
+{
+public:
+    // The speed is how many times faster than real time it's played. Nothing (or less) plays the next
+    // snapshot every time one's read, however quickly that is.
+    ReplaySource(double speed = 1.0);
+    ~ReplaySource();
+
+    // False if the file can't be read or isn't a recording. A record cut short at the end is dropped.
+    bool load(const string& path);
+
+    // Playback starts the first time it's opened, and carries on through the sim being closed again -
+    // a recording of the sim going away closes it, and that's part of the flight.
+    bool open(void);
+    bool read(Snapshot&);
+    void close(void);
+    const char* getName(void) { return "Replay"; };
+
+    size_t getFrames(void) { return mFrames.size(); };
+    bool isFinished(void) { return mNext >= mFrames.size(); };
+
+    // How long the recording runs, in seconds.
+    double getDuration(void) { return mFrames.empty() ? 0.0 : mFrames.back().t; };
+
+private:
+    struct Frame
+    {
+        double t;
+        bool connected;
+        Snapshot snapshot;
+    };
+
+    vector<Frame> mFrames;
+    double mSpeed;
+
+    bool mPlaying;
+    chrono::steady_clock::time_point mStarted;
+    size_t mNext;
+};
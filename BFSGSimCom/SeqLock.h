@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+using namespace ::std;
+
+// Publishes a small value from one writer to any number of readers, none of which ever wait for a lock.
+//
+// The sequence is odd while a write is under way. A reader copies the value out and then checks the
+// sequence didn't move while it did, trying again if it did. The value is kept as atomic words, so a copy
+// torn by a write is only ever thrown away, never acted on.
+//
+// Only one thread may store.
+template <class T>
+class SeqLock
+{
+    static_assert(is_trivially_copyable<T>::value, "SeqLock needs a value that can be copied as bytes");
+
+public:
+    SeqLock(const T& value = T()) :
+        mSequence(0)
+    {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        for (size_t i = 0; i < WORDS; i++)
+            mWords[i].store(words[i], memory_order_relaxed);
+    }
+
+    void store(const T& value)
+    {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint64_t sequence = mSequence.load(memory_order_relaxed);
+        mSequence.store(sequence + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        for (size_t i = 0; i < WORDS; i++)
+            mWords[i].store(words[i], memory_order_relaxed);
+
+        mSequence.store(sequence + 2, memory_order_release);
+    }
+
+    // A consistent copy of the value, and the version it was.
+    T load(uint64_t* version = NULL) const
+    {
+        uint64_t words[WORDS];
+        uint64_t before;
+        uint64_t after;
+
+        do
+        {
+            before = mSequence.load(memory_order_acquire);
+
+            for (size_t i = 0; i < WORDS; i++)
+                words[i] = mWords[i].load(memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_acquire);
+            after = mSequence.load(memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        if (version != NULL) *version = before / 2;
+
+        T retValue;
+        memcpy(&retValue, words, sizeof(T));
+        return retValue;
+    }
+
+    // Goes up by one with each store.
+    uint64_t getVersion(void) const { return mSequence.load(memory_order_acquire) / 2; };
+
+private:
+    static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    atomic<uint64_t> mSequence;
+    atomic<uint64_t> mWords[WORDS];
+};
@@ -0,0 +1,329 @@
+// A headless driver for the polling and the channel lookups, for running and timing them away from TS3 and a
+// simulator. It isn't part of the plugin.
+//
+// Build it on Linux, from this directory, with:
+//
+//     g++ -std=c++14 -O2 -I.. -I../SQLite3 -I"../~pluginsdk/include" -I. -o simbench SimBench.cpp
+//         FSUIPCWrapper.cpp PollScheduler.cpp LatencyHistogram.cpp SyntheticSource.cpp ReplaySource.cpp
+//         SimRecorder.cpp XPlaneSource.cpp TS3Channels.cpp ChannelIndex.cpp TuningTable.cpp GeoIndex.cpp
+//         InRangeTracker.cpp ChannelTables.cpp StringArena.cpp ICAOData.cpp ../SQLiteCpp/*.cpp -lsqlite3 -pthread
+//
+// and run it as:
+//
+//     simbench [options] script
+//
+//     -s seconds    simulated seconds each headless poll moves the script's clock on (default 1)
+//     -n polls      how many headless polls to make (default: until the script ends, or 100000 if it loops)
+//     -r file       play a recording back as fast as it's read, instead of flying a script
+//     -x host:port  read X-Plane instead (or ../FSUIPCLibrary/XPlaneSim.c, standing in for it)
+//     -c file       channels to look the tuned frequency up in, one to a line: id, parent, name, topic and
+//                   description, separated by tabs. Each lookup moves the aircraft as the plugin would.
+//     -p dir        the plugin directory, with BFSGSimCom_plugin/BFSGSimCom.db in it (default: current)
+//     -m policy     how range is used by lookups - ignore, order or limit (default: order)
+//     -t ms         run the worker thread polling at this interval instead, and report its timing
+//     -d seconds    how long to run the worker for (default 2)
+//     -k ms         stall every tenth read of the source by this long, to see overruns
+//
+// Headless, poll() is called in a loop with the script's clock stepped on each time, which shows how many
+// simulated seconds the whole pipeline gets through in a real one. With -t the worker runs as it does in the
+// plugin, with a synthetic source on real time, and what comes out is the mean period between reads (which
+// only drifts from the interval if polls overrun), the jitter, the work time, the overruns, and how long
+// stop() took to return. Reading X-Plane where there isn't one shows stop() cutting short a backoff.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "BFSGSimCom.h"
+#include "FSUIPCWrapper.h"
+#include "SyntheticSource.h"
+#include "ReplaySource.h"
+#include "XPlaneSource.h"
+#include "TS3Channels.h"
+#include "LatencyHistogram.h"
+
+using namespace std;
+
+// Where the channels look for the ICAO data; the plugin has this from TS3.
+char pluginPath[PATH_BUFSIZE] = "";
+
+static TS3Channels* channels = NULL;
+static uint64 current = TS3Channels::CHANNEL_ROOT;
+static uint64 root = TS3Channels::CHANNEL_ROOT;
+
+static uint64 callbacks = 0;
+static uint64 moves = 0;
+static LatencyHistogram lookups;
+
+// Keeps track of when a source is read, to see how regular polling is, and is slow to answer every tenth
+// time if asked to be, as a sim under load is.
+class BenchSource : public SimSource
+{
+public:
+    BenchSource(shared_ptr<SimSource> source, chrono::milliseconds stall) : mSource(source), mStall(stall), mReads(0) {};
+
+    bool open(void) { return mSource->open(); };
+    void close(void) { mSource->close(); };
+    const char* getName(void) { return mSource->getName(); };
+    bool canWait(void) { return mSource->canWait(); };
+    bool waitForData(chrono::milliseconds timeout) { return mSource->waitForData(timeout); };
+    void interrupt(void) { mSource->interrupt(); };
+
+    bool read(Snapshot& snapshot)
+    {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (mReads++ == 0) mFirst = now;
+        mLast = now;
+
+        if (mStall.count() > 0 && mReads % 10 == 0) this_thread::sleep_for(mStall);
+        return mSource->read(snapshot);
+    };
+
+    // The mean time from one read to the next.
+    chrono::microseconds getPeriod(void)
+    {
+        if (mReads < 2) return chrono::microseconds(0);
+        return chrono::duration_cast<chrono::microseconds>(mLast - mFirst) / (mReads - 1);
+    };
+
+    uint64_t getReads(void) { return mReads; };
+
+private:
+    shared_ptr<SimSource> mSource;
+    chrono::milliseconds mStall;
+    uint64_t mReads;
+    chrono::steady_clock::time_point mFirst;
+    chrono::steady_clock::time_point mLast;
+};
+
+// What the plugin's decision does with a sample, less the talking to TS3.
+static void decide(FSUIPCWrapper::SimComData data)
+{
+    callbacks++;
+
+    if (channels == NULL || !(data.blComChanged || data.blPosChanged || data.blOtherChanged)) return;
+
+    int frequency = 0;
+    if (data.selectedCom == FSUIPCWrapper::Com1) frequency = data.iCom1Freq;
+    else if (data.selectedCom == FSUIPCWrapper::Com2) frequency = data.iCom2Freq;
+
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    TS3Channels::StationInfo target = channels->lookupChannelID(frequency, current, root, data.bl833Capable, data.dLat, data.dLon);
+    lookups.record(chrono::steady_clock::now() - started);
+
+    if (target.ch != TS3Channels::CHANNEL_ID_NOT_FOUND && target.ch != TS3Channels::CHANNEL_NOT_CHILD_OF_ROOT && target.ch != current)
+    {
+        current = target.ch;
+        moves++;
+    }
+}
+
+static bool loadChannels(const string& path)
+{
+    ifstream in(path);
+    if (!in) return false;
+
+    channels->beginRebuild(path);
+
+    string line;
+    uint64 order = 0;
+
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        string field[5];
+        stringstream ssLine(line);
+        for (int i = 0; i < 5; i++) getline(ssLine, field[i], '\t');
+
+        uint64 channelID = strtoull(field[0].c_str(), NULL, 10);
+        uint64 parent = strtoull(field[1].c_str(), NULL, 10);
+
+        channels->queueChannel(field[2], field[3], field[4], channelID, parent, order++, NULL);
+    }
+
+    channels->commitRebuild();
+
+    return true;
+}
+
+static void usage(void)
+{
+    cerr << "usage: simbench [-s seconds] [-n polls] [-r recording | -x host:port] [-c channels] [-p dir]" << endl;
+    cerr << "                [-m ignore|order|limit] [-t ms] [-d seconds] [-k ms] [script]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    double step = 1.0;
+    long polls = -1;
+    string recording;
+    string xplane;
+    string channelFile;
+    string policy = "order";
+    int interval = 0;
+    double duration = 2.0;
+    int stall = 0;
+    string script;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool blValue = (i + 1 < argc);
+
+        if (arg == "-s" && blValue) step = atof(argv[++i]);
+        else if (arg == "-n" && blValue) polls = atol(argv[++i]);
+        else if (arg == "-r" && blValue) recording = argv[++i];
+        else if (arg == "-x" && blValue) xplane = argv[++i];
+        else if (arg == "-c" && blValue) channelFile = argv[++i];
+        else if (arg == "-p" && blValue) snprintf(pluginPath, PATH_BUFSIZE, "%s/", argv[++i]);
+        else if (arg == "-m" && blValue) policy = argv[++i];
+        else if (arg == "-t" && blValue) interval = atoi(argv[++i]);
+        else if (arg == "-d" && blValue) duration = atof(argv[++i]);
+        else if (arg == "-k" && blValue) stall = atoi(argv[++i]);
+        else if (arg[0] != '-' && script.empty()) script = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    // Run on the worker, the script's flown on real time; headless, it's stepped on with each poll.
+    shared_ptr<SimSource> source;
+    shared_ptr<SyntheticSource> synthetic;
+    shared_ptr<ReplaySource> replay;
+
+    if (!recording.empty())
+    {
+        replay = make_shared<ReplaySource>(interval > 0 ? 1.0 : 0.0);
+        if (!replay->load(recording))
+        {
+            cerr << recording << ": not a recording" << endl;
+            return 1;
+        }
+        source = replay;
+    }
+    else if (!xplane.empty())
+    {
+        size_t colon = xplane.find(':');
+        string host = xplane.substr(0, colon);
+        int port = (colon == string::npos) ? 49000 : atoi(xplane.c_str() + colon + 1);
+        source = make_shared<XPlaneSource>(host, port);
+    }
+    else if (!script.empty())
+    {
+        synthetic = make_shared<SyntheticSource>(1.0, interval > 0 ? 0.0 : step);
+        int line = synthetic->loadFile(script);
+        if (line != 0)
+        {
+            cerr << script << ": can't be read at line " << line << endl;
+            return 1;
+        }
+        source = synthetic;
+    }
+    else
+    {
+        usage();
+        return 2;
+    }
+
+    shared_ptr<BenchSource> bench = make_shared<BenchSource>(source, chrono::milliseconds(stall));
+    source = bench;
+
+    if (!channelFile.empty())
+    {
+        try
+        {
+            channels = new TS3Channels();
+        }
+        catch (exception& e)
+        {
+            cerr << "channels: " << e.what() << " (is -p the plugin directory?)" << endl;
+            return 1;
+        }
+
+        channels->setLookupPolicy(policy != "ignore", policy == "limit");
+
+        if (!loadChannels(channelFile))
+        {
+            cerr << channelFile << ": can't be read" << endl;
+            return 1;
+        }
+
+        TS3Channels::Statistics statistics = channels->getStatistics();
+        cout << "channels: " << statistics.parsed << " parsed, " << statistics.failed << " failed" << endl;
+    }
+
+    if (interval > 0)
+    {
+        PollScheduler::Rates rates;
+        rates.burst = rates.normal = rates.cruise = chrono::milliseconds(interval);
+
+        FSUIPCWrapper wrapper(decide, source, rates);
+
+        wrapper.start();
+        this_thread::sleep_for(chrono::duration<double>(duration));
+
+        chrono::steady_clock::time_point stopping = chrono::steady_clock::now();
+        wrapper.stop();
+        chrono::steady_clock::duration stopped = chrono::steady_clock::now() - stopping;
+
+        const FSUIPCWrapper::PollTiming& timing = wrapper.getTiming();
+
+        cout << "source:   " << wrapper.getSourceName() << ", " << PollScheduler::toString(wrapper.getPollMode()) << " at " << wrapper.getPollInterval() << "ms" << endl;
+        cout << "polls:    " << timing.work.getCount() << " in " << duration << "s, " << callbacks << " callbacks" << endl;
+        if (bench->getReads() > 1)
+            cout << "period:   " << bench->getPeriod().count() << "us over " << bench->getReads() << " reads, " << (bench->getPeriod() - chrono::milliseconds(interval)).count() << "us from the interval" << endl;
+        else
+            cout << "period:   nothing read" << endl;
+        cout << "jitter:   " << timing.jitter.toString() << endl;
+        cout << "work:     " << timing.work.toString() << endl;
+        cout << "overruns: " << timing.overruns << endl;
+        cout << "stop:     " << chrono::duration_cast<chrono::microseconds>(stopped).count() << "us" << endl;
+    }
+    else
+    {
+        if (polls < 0) polls = (synthetic != NULL) ? long(synthetic->getDuration() / step) + 1 : 100000;
+
+        FSUIPCWrapper wrapper(decide, source);
+        LatencyHistogram polled;
+        long made = 0;
+
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+        for (; made < polls; made++)
+        {
+            chrono::steady_clock::time_point before = chrono::steady_clock::now();
+            wrapper.poll();
+            polled.record(chrono::steady_clock::now() - before);
+
+            if (replay != NULL && replay->isFinished()) break;
+        }
+
+        double wall = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        double simulated = (synthetic != NULL) ? made * step : (replay != NULL ? replay->getDuration() : 0.0);
+
+        cout << "source:   " << wrapper.getSourceName() << (wrapper.isConnected() ? "" : " (not connected)") << endl;
+        cout << "polls:    " << made << " in " << wall << "s, " << callbacks << " callbacks" << endl;
+        if (simulated > 0.0) cout << "speed:    " << simulated / wall << " simulated seconds a second" << endl;
+        cout << "poll:     " << polled.toString() << endl;
+
+        if (channels != NULL)
+        {
+            cout << "lookups:  " << lookups.toString() << endl;
+            cout << "moves:    " << moves << ", now in channel " << current << endl;
+        }
+    }
+
+    delete channels;
+
+    return 0;
+}
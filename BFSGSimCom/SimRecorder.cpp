@@ -0,0 +1,146 @@
+#include <cmath>
+
+#include "SimRecorder.h"
+
+using namespace std;
+
+const char SimRecorder::MAGIC[8] = { 'B', 'F', 'S', 'G', 'R', 'E', 'C', 'D' };
+const uint32_t SimRecorder::VERSION;
+const double SimRecorder::POSITION_SCALE = 1e7;
+
+SimRecorder::SimRecorder(size_t blockSize) :
+    mBlockSize(blockSize),
+    mRecords(0),
+    mLastLat(0),
+    mLastLon(0)
+{
+    mBuffer.reserve(mBlockSize + 64);
+}
+
+SimRecorder::~SimRecorder()
+{
+    close();
+}
+
+bool SimRecorder::open(const string& path)
+{
+    close();
+
+    mOut.open(path, ios::binary | ios::trunc);
+    if (!mOut) return false;
+
+    mOut.write(MAGIC, sizeof(MAGIC));
+    mOut.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+
+    mRecords = 0;
+    mLast = SimSource::Snapshot();
+    mLastLat = 0;
+    mLastLon = 0;
+    mLastTime = chrono::steady_clock::now();
+
+    return bool(mOut);
+}
+
+void SimRecorder::close(void)
+{
+    if (!mOut.is_open()) return;
+
+    flush();
+    mOut.close();
+}
+
+void SimRecorder::record(const SimSource::Snapshot& snapshot)
+{
+    if (!mOut.is_open()) return;
+
+    int64_t lat = toFixed(snapshot.lat);
+    int64_t lon = toFixed(snapshot.lon);
+
+    uint8_t fields = 0;
+    if (snapshot.com1 != mLast.com1) fields |= FIELD_COM1;
+    if (snapshot.com1Sby != mLast.com1Sby) fields |= FIELD_COM1SBY;
+    if (snapshot.com2 != mLast.com2) fields |= FIELD_COM2;
+    if (snapshot.com2Sby != mLast.com2Sby) fields |= FIELD_COM2SBY;
+    if (packSwitches(snapshot) != packSwitches(mLast)) fields |= FIELD_SWITCHES;
+    if (lat != mLastLat || lon != mLastLon) fields |= FIELD_POSITION;
+
+    begin(fields);
+
+    if (fields & FIELD_COM1) putSigned(int64_t(snapshot.com1) - mLast.com1);
+    if (fields & FIELD_COM1SBY) putSigned(int64_t(snapshot.com1Sby) - mLast.com1Sby);
+    if (fields & FIELD_COM2) putSigned(int64_t(snapshot.com2) - mLast.com2);
+    if (fields & FIELD_COM2SBY) putSigned(int64_t(snapshot.com2Sby) - mLast.com2Sby);
+    if (fields & FIELD_SWITCHES) mBuffer.push_back(packSwitches(snapshot));
+
+    if (fields & FIELD_POSITION)
+    {
+        putSigned(lat - mLastLat);
+        putSigned(lon - mLastLon);
+    }
+
+    mLast = snapshot;
+    mLastLat = lat;
+    mLastLon = lon;
+
+    end();
+}
+
+void SimRecorder::recordDisconnected(void)
+{
+    if (!mOut.is_open()) return;
+
+    begin(FIELD_DISCONNECTED);
+    end();
+}
+
+uint8_t SimRecorder::packSwitches(const SimSource::Snapshot& snapshot)
+{
+    return uint8_t((snapshot.selectedCom & SWITCHES_COM) | (snapshot.onGround ? SWITCHES_GROUND : 0) | (snapshot.is833 ? SWITCHES_833 : 0));
+}
+
+int64_t SimRecorder::toFixed(double degrees)
+{
+    return int64_t(floor(degrees * POSITION_SCALE + 0.5));
+}
+
+void SimRecorder::begin(uint8_t fields)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    mBuffer.push_back(fields);
+    put(uint64_t(chrono::duration_cast<chrono::microseconds>(now - mLastTime).count()));
+
+    mLastTime = now;
+}
+
+void SimRecorder::end(void)
+{
+    mRecords++;
+
+    if (mBuffer.size() >= mBlockSize) flush();
+}
+
+void SimRecorder::put(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        mBuffer.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+
+    mBuffer.push_back(uint8_t(value));
+}
+
+void SimRecorder::putSigned(int64_t value)
+{
+    put((uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+void SimRecorder::flush(void)
+{
+    if (mBuffer.empty()) return;
+
+    mOut.write(reinterpret_cast<const char*>(mBuffer.data()), mBuffer.size());
+    mOut.flush();
+    mBuffer.clear();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "SimSource.h"
+
+using namespace ::std;
+
+// Records every snapshot the poller sees, so the flight can be played back later through a ReplaySource.
+//
+// The file starts with the magic and a version, followed by one record per poll, only ever appended to.
+// A record is a byte saying which fields have changed since the record before, the time since that one
+// in microseconds, and then the new values of just those fields. Frequencies and positions are stored as
+// the difference from before, zig-zag encoded so that small changes either way stay small, in as few
+// seven bit groups as they'll fit in. Positions are kept to 1e-7 of a degree.
+//
+// Records are built up in memory and written out a block at a time, so recording costs the poll thread
+// little more than a few bytes of arithmetic. A crash loses at most the last block, and a record that's
+// been cut short is ignored on replay.
+class SimRecorder
+{
+public:
+    enum Field
+    {
+        FIELD_COM1 = 0x01,
+        FIELD_COM1SBY = 0x02,
+        FIELD_COM2 = 0x04,
+        FIELD_COM2SBY = 0x08,
+        FIELD_SWITCHES = 0x10,
+        FIELD_POSITION = 0x20,
+        FIELD_DISCONNECTED = 0x40
+    };
+
+    // The selector, on ground and 8.33 flags are packed into the one switches byte.
+    enum Switches
+    {
+        SWITCHES_COM = 0x03,
+        SWITCHES_GROUND = 0x04,
+        SWITCHES_833 = 0x08
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    static const double POSITION_SCALE;
+
+    SimRecorder(size_t blockSize = 16384);
+    ~SimRecorder();
+
+    // Starts a new recording, replacing anything already at the path.
+    bool open(const string& path);
+    void close(void);
+
+    bool isOpen(void) { return mOut.is_open(); };
+    uint64_t getRecords(void) { return mRecords; };
+
+    void record(const SimSource::Snapshot& snapshot);
+
+    // The sim couldn't be read this time.
+    void recordDisconnected(void);
+
+    static uint8_t packSwitches(const SimSource::Snapshot& snapshot);
+    static int64_t toFixed(double degrees);
+
+private:
+    ofstream mOut;
+    size_t mBlockSize;
+    vector<uint8_t> mBuffer;
+    uint64_t mRecords;
+
+    // What was last recorded, which the next record is the difference from.
+    SimSource::Snapshot mLast;
+    int64_t mLastLat;
+    int64_t mLastLon;
+    chrono::steady_clock::time_point mLastTime;
+
+    void begin(uint8_t fields);
+    void end(void);
+    void put(uint64_t value);
+    void putSigned(int64_t value);
+    void flush(void);
+};
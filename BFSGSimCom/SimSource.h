@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+using namespace ::std;
+
+// Somewhere the aircraft's radios and position come from - a simulator through FSUIPC, or a scripted flight.
+class SimSource
+{
+public:
+    enum ComRadio
+    {
+        None = 0,
+        Com1 = 1,
+        Com2 = 2,
+        Com12 = 3
+    };
+
+    // What the sim says now. Frequencies are in kHz, whatever spacing the radios use.
+    struct Snapshot
+    {
+        int com1;
+        int com1Sby;
+        int com2;
+        int com2Sby;
+        ComRadio selectedCom;
+        bool onGround;
+        double lat;
+        double lon;
+        bool is833;
+
+        Snapshot() : com1(0), com1Sby(0), com2(0), com2Sby(0), selectedCom(None), onGround(false), lat(0.0), lon(0.0), is833(false) {};
+    };
+
+    virtual ~SimSource() {};
+
+    // Connects, if it isn't already. True if it's connected.
+    virtual bool open(void) = 0;
+
+    // Fills in the latest snapshot. False if the sim couldn't be read.
+    virtual bool read(Snapshot&) = 0;
+
+    virtual void close(void) = 0;
+    virtual const char* getName(void) = 0;
+
+    // True if the sim sends on its own, so waitForData can tell when there's something new.
+    virtual bool canWait(void) { return false; };
+
+    // Waits up to the timeout for the sim to have something new, true if it has. Sources that only answer
+    // when asked can't tell, so they just wait it out.
+    virtual bool waitForData(chrono::milliseconds timeout)
+    {
+        this_thread::sleep_for(timeout);
+        return false;
+    };
+
+    // Cuts short a waitForData under way on another thread, or the next one if there isn't one.
+    virtual void interrupt(void) {};
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+using namespace ::std;
+
+// Publishes immutable snapshots of a T from a single writer to any number of readers.
+//
+// Readers never wait for the writer: they announce the epoch they started in, pick up the current
+// pointer and use it for as long as they hold a ReadGuard. The writer swaps in the next version and
+// retires the previous one, which is only deleted once every reader which could have seen it has
+// finished. Calls to publish() must be serialised by the caller.
+template <class T>
+class SnapshotPublisher
+{
+private:
+    static const int MAX_READERS = 32;
+
+    struct ReaderSlot
+    {
+        atomic<bool> claimed;
+        atomic<uint64_t> epoch;
+    };
+
+    atomic<const T*> mCurrent;
+    atomic<uint64_t> mEpoch;
+    ReaderSlot mReaders[MAX_READERS];
+
+    // Retired snapshots, and the epoch in which they were retired.
+    vector<pair<const T*, uint64_t>> mRetired;
+
+    // Deletes any retired snapshots which no reader can still be looking at.
+    void reclaim(void)
+    {
+        uint64_t oldest = UINT64_MAX;
+
+        for (int i = 0; i < MAX_READERS; i++)
+        {
+            uint64_t e = mReaders[i].epoch.load();
+            if (e != 0 && e < oldest) oldest = e;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < mRetired.size(); i++)
+        {
+            if (mRetired[i].second <= oldest)
+                delete mRetired[i].first;
+            else
+                mRetired[kept++] = mRetired[i];
+        }
+        mRetired.resize(kept);
+    }
+
+public:
+    class ReadGuard
+    {
+    private:
+        SnapshotPublisher& mPublisher;
+        int mSlot;
+        const T* mSnapshot;
+
+    public:
+        ReadGuard(SnapshotPublisher& publisher) : mPublisher(publisher), mSlot(0)
+        {
+            // Claim a free slot. There are more slots than threads which read, so this normally
+            // succeeds first time.
+            for (;;)
+            {
+                bool expected = false;
+                if (mPublisher.mReaders[mSlot].claimed.compare_exchange_weak(expected, true))
+                    break;
+                mSlot = (mSlot + 1) % MAX_READERS;
+            }
+
+            // Announce the epoch before loading the pointer - anything retired after this can't be freed under us.
+            mPublisher.mReaders[mSlot].epoch.store(mPublisher.mEpoch.load());
+            mSnapshot = mPublisher.mCurrent.load();
+        }
+
+        ~ReadGuard()
+        {
+            mPublisher.mReaders[mSlot].epoch.store(0);
+            mPublisher.mReaders[mSlot].claimed.store(false);
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        const T* get(void) const { return mSnapshot; };
+        const T* operator->(void) const { return mSnapshot; };
+        const T& operator*(void) const { return *mSnapshot; };
+    };
+
+    SnapshotPublisher(const T* initial) : mCurrent(initial), mEpoch(1)
+    {
+        for (int i = 0; i < MAX_READERS; i++)
+        {
+            mReaders[i].claimed.store(false);
+            mReaders[i].epoch.store(0);
+        }
+    }
+
+    ~SnapshotPublisher()
+    {
+        // By the time we're destroyed there can't be any readers left.
+        for (auto& retired : mRetired) delete retired.first;
+        delete mCurrent.load();
+    }
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Makes next the current snapshot and takes ownership of it.
+    void publish(const T* next)
+    {
+        const T* previous = mCurrent.exchange(next);
+
+        // Readers which announce this epoch or later must have loaded the new pointer.
+        uint64_t retiredIn = mEpoch.fetch_add(1) + 1;
+        mRetired.push_back(make_pair(previous, retiredIn));
+
+        reclaim();
+    }
+};
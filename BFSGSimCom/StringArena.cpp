@@ -0,0 +1,70 @@
+#include <cstring>
+
+#include "StringArena.h"
+
+using namespace std;
+
+StringArena& StringArena::shared(void)
+{
+    static StringArena arena;
+    return arena;
+}
+
+StringArena::StringArena() :
+    mChunkUsed(0),
+    mChunkSize(0),
+    mBytes(0)
+{
+}
+
+const char* StringArena::intern(const string& str)
+{
+    size_t hash = std::hash<string>()(str);
+    size_t len = str.length() + 1;
+
+    lock_guard<mutex> lock(mLock);
+
+    auto range = mStrings.equal_range(hash);
+    for (auto existing = range.first; existing != range.second; ++existing)
+    {
+        if (strcmp(existing->second, str.c_str()) == 0) return existing->second;
+    }
+
+    // Anything too big for a chunk gets one to itself, and the current chunk carries on being filled.
+    char* copy;
+    if (len > CHUNK_SIZE)
+    {
+        mChunks.insert(mChunks.begin(), unique_ptr<char[]>(new char[len]));
+        copy = mChunks.front().get();
+    }
+    else
+    {
+        if (mChunks.empty() || mChunkUsed + len > mChunkSize)
+        {
+            mChunks.push_back(unique_ptr<char[]>(new char[CHUNK_SIZE]));
+            mChunkSize = CHUNK_SIZE;
+            mChunkUsed = 0;
+        }
+
+        copy = mChunks.back().get() + mChunkUsed;
+        mChunkUsed += len;
+    }
+
+    memcpy(copy, str.c_str(), len);
+    mBytes += len;
+    mStrings.insert(make_pair(hash, copy));
+
+    return copy;
+}
+
+size_t StringArena::getCount(void)
+{
+    lock_guard<mutex> lock(mLock);
+    return mStrings.size();
+}
+
+size_t StringArena::getBytes(void)
+{
+    lock_guard<mutex> lock(mLock);
+    return mBytes;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace ::std;
+
+// Holds one copy of each distinct string it's given, for the life of the plugin.
+//
+// Channel names and station idents are repeated across reloads, generations and server connections, so
+// records keep a pointer into the arena instead of a copy of their own. Strings are packed into large chunks
+// which never move or get freed, so a pointer, once handed out, can be read from any thread without a lock.
+class StringArena
+{
+public:
+    static StringArena& shared(void);
+
+    const char* intern(const string&);
+
+    size_t getCount(void);
+    size_t getBytes(void);
+
+private:
+    static const size_t CHUNK_SIZE = 65536;
+
+    mutex mLock;
+    vector<unique_ptr<char[]>> mChunks;
+    size_t mChunkUsed;
+    size_t mChunkSize;
+    size_t mBytes;
+
+    // Interned strings by hash, to find an existing copy.
+    unordered_multimap<size_t, const char*> mStrings;
+
+    StringArena();
+    StringArena(const StringArena&);
+    StringArena& operator=(const StringArena&);
+};
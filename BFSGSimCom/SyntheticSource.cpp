@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "SyntheticSource.h"
+
+using namespace std;
+
+// Same radius as getDistanceBetweenLatLonInNm.
+static const double aEarthRadiusNm = 3437.746;
+static const double aDeg2Rad = 3.14159265358979323846 / 180.0;
+
+static void toXYZ(double lat, double lon, double xyz[3])
+{
+    xyz[0] = cos(lat * aDeg2Rad) * cos(lon * aDeg2Rad);
+    xyz[1] = cos(lat * aDeg2Rad) * sin(lon * aDeg2Rad);
+    xyz[2] = sin(lat * aDeg2Rad);
+}
+
+// The angle between two points, from the centre of the earth, in radians.
+static double angleBetween(double lat1, double lon1, double lat2, double lon2)
+{
+    double a[3];
+    double b[3];
+    toXYZ(lat1, lon1, a);
+    toXYZ(lat2, lon2, b);
+
+    double cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+
+    return atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot);
+}
+
+SyntheticSource::SyntheticSource(double timeScale, double step) :
+    mDuration(0.0),
+    mLoop(false),
+    mTimeScale(timeScale),
+    mStep(step),
+    mOpen(false),
+    mElapsed(0.0)
+{
+}
+
+SyntheticSource::~SyntheticSource()
+{
+}
+
+int SyntheticSource::load(const string& script)
+{
+    vector<Segment> segments;
+    bool loop = false;
+
+    // Where the script has got to - the time, the position and how the radios are set.
+    double t = 0.0;
+    double lat = 0.0;
+    double lon = 0.0;
+    double speed = 0.0;
+    Snapshot state;
+    bool stateChanged = true;
+
+    istringstream lines(script);
+    string line;
+    int lineNo = 0;
+
+    while (getline(lines, line))
+    {
+        lineNo++;
+
+        size_t comment = line.find('#');
+        if (comment != string::npos) line.erase(comment);
+
+        istringstream words(line);
+        string command;
+        if (!(words >> command)) continue;
+
+        transform(command.begin(), command.end(), command.begin(), ::tolower);
+
+        bool ok = true;
+        Segment segment;
+        segment.start = t;
+        segment.fromLat = lat;
+        segment.fromLon = lon;
+
+        if (command == "start")
+        {
+            ok = bool(words >> lat >> lon);
+            stateChanged = true;
+        }
+        else if (command == "speed")
+        {
+            ok = (words >> speed) && speed > 0.0;
+        }
+        else if (command == "leg")
+        {
+            ok = (words >> segment.toLat >> segment.toLon) && speed > 0.0;
+            if (ok)
+            {
+                double distance = angleBetween(lat, lon, segment.toLat, segment.toLon) * aEarthRadiusNm;
+
+                t += 3600.0 * distance / speed;
+                lat = segment.toLat;
+                lon = segment.toLon;
+            }
+        }
+        else if (command == "wait")
+        {
+            double seconds;
+            ok = (words >> seconds) && seconds >= 0.0;
+            if (ok)
+            {
+                segment.toLat = lat;
+                segment.toLon = lon;
+                t += seconds;
+            }
+        }
+        else if (command == "com1" || command == "com1sby" || command == "com2" || command == "com2sby")
+        {
+            double mhz;
+            ok = bool(words >> mhz);
+            if (ok)
+            {
+                int khz = int(floor(mhz * 1000.0 + 0.5));
+
+                if (command == "com1") state.com1 = khz;
+                else if (command == "com1sby") state.com1Sby = khz;
+                else if (command == "com2") state.com2 = khz;
+                else state.com2Sby = khz;
+
+                stateChanged = true;
+            }
+        }
+        else if (command == "swap")
+        {
+            string radio;
+            ok = bool(words >> radio);
+            if (radio == "com1") swap(state.com1, state.com1Sby);
+            else if (radio == "com2") swap(state.com2, state.com2Sby);
+            else ok = false;
+
+            stateChanged = true;
+        }
+        else if (command == "select")
+        {
+            string radio;
+            ok = bool(words >> radio);
+            if (radio == "com1") state.selectedCom = Com1;
+            else if (radio == "com2") state.selectedCom = Com2;
+            else if (radio == "both") state.selectedCom = Com12;
+            else if (radio == "none") state.selectedCom = None;
+            else ok = false;
+
+            stateChanged = true;
+        }
+        else if (command == "ground" || command == "833")
+        {
+            string onOff;
+            ok = bool(words >> onOff) && (onOff == "on" || onOff == "off");
+
+            if (command == "ground") state.onGround = (onOff == "on");
+            else state.is833 = (onOff == "on");
+
+            stateChanged = true;
+        }
+        else if (command == "loop")
+        {
+            loop = true;
+        }
+        else
+        {
+            ok = false;
+        }
+
+        string extra;
+        if (!ok || (words >> extra)) return lineNo;
+
+        if (command == "leg" || command == "wait")
+        {
+            segment.end = t;
+            segment.state = state;
+            segments.push_back(segment);
+
+            stateChanged = false;
+        }
+    }
+
+    // Anything set after the last leg still needs somewhere to be seen, so hold it there.
+    if (stateChanged || segments.empty())
+    {
+        Segment segment;
+        segment.start = segment.end = t;
+        segment.fromLat = segment.toLat = lat;
+        segment.fromLon = segment.toLon = lon;
+        segment.state = state;
+        segments.push_back(segment);
+    }
+
+    mSegments.swap(segments);
+    mDuration = t;
+    mLoop = loop;
+    mElapsed = 0.0;
+
+    return 0;
+}
+
+int SyntheticSource::loadFile(const string& path)
+{
+    ifstream file(path.c_str());
+    if (!file) return -1;
+
+    ostringstream script;
+    script << file.rdbuf();
+
+    return load(script.str());
+}
+
+bool SyntheticSource::open(void)
+{
+    if (!mOpen && !mSegments.empty())
+    {
+        mOpen = true;
+        mStarted = chrono::steady_clock::now();
+        mElapsed = 0.0;
+    }
+
+    return mOpen;
+}
+
+bool SyntheticSource::read(Snapshot& snapshot)
+{
+    if (!mOpen) return false;
+
+    if (mStep > 0.0)
+        mElapsed += mStep;
+    else
+        mElapsed = chrono::duration<double>(chrono::steady_clock::now() - mStarted).count() * mTimeScale;
+
+    // Once it's finished it either goes round again or stays where it ended up.
+    double t = mElapsed;
+    if (mLoop && mDuration > 0.0)
+        t = fmod(t, mDuration);
+    else
+        t = (min)(t, mDuration);
+
+    // The segment that's under way is the last to have started - but at a point where one ends and another
+    // starts, it's the later one, so radio changes made there are seen.
+    vector<Segment>::const_iterator segment = upper_bound(mSegments.begin(), mSegments.end(), t,
+        [](double time, const Segment& s) { return time < s.start; });
+    if (segment != mSegments.begin()) --segment;
+
+    snapshot = segment->state;
+    interpolate(*segment, t, snapshot.lat, snapshot.lon);
+
+    return true;
+}
+
+void SyntheticSource::close(void)
+{
+    mOpen = false;
+}
+
+// Somewhere along the great circle the segment follows, by how far through it we are.
+void SyntheticSource::interpolate(const Segment& segment, double t, double& lat, double& lon)
+{
+    double angle = angleBetween(segment.fromLat, segment.fromLon, segment.toLat, segment.toLon);
+    double duration = segment.end - segment.start;
+
+    if (angle < 1e-12 || duration <= 0.0)
+    {
+        lat = segment.toLat;
+        lon = segment.toLon;
+        return;
+    }
+
+    double fraction = (min)((max)((t - segment.start) / duration, 0.0), 1.0);
+
+    double a[3];
+    double b[3];
+    toXYZ(segment.fromLat, segment.fromLon, a);
+    toXYZ(segment.toLat, segment.toLon, b);
+
+    double wa = sin((1.0 - fraction) * angle) / sin(angle);
+    double wb = sin(fraction * angle) / sin(angle);
+
+    double p[3] = { wa * a[0] + wb * b[0], wa * a[1] + wb * b[1], wa * a[2] + wb * b[2] };
+
+    lat = atan2(p[2], sqrt(p[0] * p[0] + p[1] * p[1])) / aDeg2Rad;
+    lon = atan2(p[1], p[0]) / aDeg2Rad;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "SimSource.h"
+
+using namespace ::std;
+
+// A made up flight, for running the plugin without a simulator. It flies a script - great circle legs
+// at a given speed, with the radios retuned and the selector switched along the way - on a clock of its
+// own, which can run faster than real time.
+//
+// A script has one command to a line, and anything after a # is ignored:
+//
+//     start 51.4700 -0.4543         put the aircraft here
+//     speed 250                     in knots, for the legs that follow
+//     leg 53.3537 -2.2750           fly the great circle from where we are to here
+//     wait 60                       stay where we are, for this many seconds
+//     com1 121.900                  also com1sby, com2 and com2sby - in MHz
+//     swap com1                     exchange com1 (or com2) with its standby
+//     select com2                   com1, com2, both or none
+//     ground off                    on or off
+//     833 on                        the radios are 8.33KHz capable, or not
+//     loop                          start again from the top once the end is reached
+//
+// Radio and switch changes happen at the point in the script they're written, so to retune partway
+// along a route, split it into two legs.
+class SyntheticSource : public SimSource
+{
+public:
+    // The time scale is how many simulated seconds go by in a real one. If a step's given, each read moves
+    // the clock on by that many simulated seconds instead, however long it's really been - which is what
+    // something driving the polling in a tight loop wants.
+    SyntheticSource(double timeScale = 1.0, double step = 0.0);
+    ~SyntheticSource();
+
+    // These return 0 if the script's loaded, or the number of the first line that couldn't be understood
+    // (-1 if the file couldn't be read).
+    int load(const string& script);
+    int loadFile(const string& path);
+
+    bool open(void);
+    bool read(Snapshot&);
+    void close(void);
+    const char* getName(void) { return "Synthetic"; };
+
+    // How long the script takes to fly once, and how far into it we are, in simulated seconds.
+    double getDuration(void) { return mDuration; };
+    double getElapsed(void) { return mElapsed; };
+
+private:
+    // A stretch of the script with the radios set one way, flying (or standing) from one point to another.
+    struct Segment
+    {
+        double start;
+        double end;
+        double fromLat;
+        double fromLon;
+        double toLat;
+        double toLon;
+        Snapshot state;
+    };
+
+    vector<Segment> mSegments;
+    double mDuration;
+    bool mLoop;
+
+    double mTimeScale;
+    double mStep;
+
+    bool mOpen;
+    chrono::steady_clock::time_point mStarted;
+    double mElapsed;
+
+    static void interpolate(const Segment& segment, double t, double& lat, double& lon);
+};
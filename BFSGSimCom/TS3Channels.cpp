@@ -1,901 +1,1779 @@
-#include <regex>
-#include <string>
-#include <map>
-#include <sstream>
-
-#include <ShlObj.h>
-
-#include <SQLiteCpp\Transaction.h>
-
-#include "TS3Channels.h"
-#include "ICAOData.h"
-
-using namespace std;
-
-ICAOData* icaoData = NULL;
-
-string TS3Channels::determineChanDbFileName(void)
-{
-    string retValue = "";
-
-#if defined(_DEBUG)
-    WCHAR* wpath = NULL;
-    char cpath[_MAX_PATH];
-    char defChar = ' ';
-
-    if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_Documents, 0, NULL, &wpath)))
-    {
-        int rc = WideCharToMultiByte(CP_ACP, 0, wpath, -1, cpath, _MAX_PATH, &defChar, NULL);
-        retValue = string(cpath) + "\\bfsgsimcom.db3";
-
-        CoTaskMemFree(static_cast<void*>(wpath));
-    }
-
-#else
-    retValue = ":memory:";
-#endif
-
-    return retValue;
-}
-
-// Constructor for the TS3 channel class
-TS3Channels::TS3Channels() :
-    mChanDbFileName(determineChanDbFileName()),
-    mChanDb(TS3Channels::mChanDbFileName, SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE)
-{
-	icaoData = new ICAOData();
-    initDatabase();
-}
-
-TS3Channels::~TS3Channels()
-{
-}
-
-int TS3Channels::initDatabase()
-{
-    int retValue = SQLITE_OK;
-
-	static const string aInitDatabase = \
-		"DROP TABLE IF EXISTS channels;" \
-		"DROP TABLE IF EXISTS closure;" \
-		"DROP TABLE IF EXISTS channelFrequency;" \
-		"CREATE TABLE IF NOT EXISTS channels(" \
-		"   channelId UNSIGNED BIG INT PRIMARY KEY NOT NULL, "  \
-		"   latitude DOUBLE, " \
-		"   longitude DOUBLE, " \
-		"   range DOUBLE, " \
-		"   parent UNSIGNED BIG INT, "  \
-		"   ordering UNSIGNED BIG INT, "  \
-		"   name CHAR(256)," \
-		"   station CHAR(16)," \
-		"   topic CHAR(256)," \
-		"   description TEXT," \
-		"   FOREIGN KEY (parent) REFERENCES channels (channelId)" \
-		"); " \
-		"create table if not exists closure(" \
-		"   parent unsigned big int not null," \
-		"   child unsigned big int not null," \
-		"   depth int not null" \
-		");" \
-		"create table if not exists channelFrequency(" \
-		"   channel UNSIGNED BIG INT NOT NULL," \
-		"   frequency INT," \
-		"   freq833 INT," \
-		"   PRIMARY KEY (channel, frequency, freq833)," \
-		"   FOREIGN KEY (channel) REFERENCES channels (channelId)"
-		");" \
-		"create unique index if not exists closureprntchld on closure(parent, child, depth);" \
-		"create unique index if not exists closurechldprnt on closure(child, parent, depth);" \
-		"create index parent_idx on channels(parent);" \
-		"delete from channels;" \
-		"delete from closure;" \
-		"delete from channelFrequency;" \
-        "insert into channels(channelId, latitude, longitude, range, parent, ordering, name, station, topic, description) values (0, null, null, null, 0, 0, 'Root', 'Root Channel', 'Root Channel', 'Root Channel');"
-        "insert into closure(parent, child, depth) values (0, 0, 0);" \
-        "";
-
-    try
-    {
-        mChanDb.exec(aInitDatabase);
-    }
-    catch (SQLite::Exception& e)
-    {
-        e;
-        retValue = mChanDb.getErrorCode();
-    }
-
-    sqlite3_create_function(mChanDb.getHandle(), "range", 4, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, &distanceFunc, NULL, NULL);
-
-    return retValue;
-}
-
-
-vector<tuple<uint32_t, bool>> TS3Channels::getFrequenciesFromString(string str1)
-{
-	const vector<string> strs = { str1 };
-	return getFrequenciesFromStrings(strs);
-}
-
-
-vector<tuple<uint32_t, bool>> TS3Channels::getFrequenciesFromStrings(string str1, string str2, string str3)
-{
-	const vector<string> strs = { str1, str2, str3 };
-	return getFrequenciesFromStrings(strs);
-}
-
-
-vector<tuple<uint32_t, bool>> TS3Channels::getFrequenciesFromStrings(const vector<string> &strs)
-{
-	// A valid frequency is quite complicated!.
-	// This first one also matches nav frequencies for when ATIS is transmitted on them. Future enhancement!
-	//static regex r("(1((?:(?:(?:0[89])|(?:1[0-7]))\\.[0-9][05]?0?)|(?:(?:1[89]|2[0-9]|3[0-6])\\.(?:[0-9](?:(?:(?:(?:0|1|3|4|5|6|8|9)0)|(?:(?:0|1|2|3|5|6|7|8)5)|[0257]))))))\\s*");
-	static regex r("(1(?:(?:(?:1[89]|2[0-9]|3[0-6])\\.(?:[0-9](?:(?:((?:(?:0|1|3|4|5|6|8|9)0)|(?:(?:0|1|2|3|5|6|7|8)5))|([0257])))))))\\s*");
-
-	smatch matchedFrequency;
-	vector<tuple<uint32_t, bool>> frequency;
-
-	// Intermediate lists of discovered frequencies
-	vector<uint32_t> freq25;
-	vector<uint32_t> freq25or833;
-	vector<uint32_t> freq833;
-	
-	//Iterating through each string in the vector we were sent.
-	for (string str : strs)
-	{
-		// Look for all frequencies in the string.
-		while (std::regex_search(str, matchedFrequency, r)) {
-
-			string freq_str = matchedFrequency[1].str();
-			uint32_t freq = uint32_t(1000 * std::stod(freq_str) + 0.5);
-
-			// Categorise the frequency we found...
-			// If there are only two DP, then it's 25 only = for now.
-			if (matchedFrequency[3].str().length() > 0)
-			{
-				// If the last digit is a 2 or a 7, then it should be 25 or 75 really.
-				if (matchedFrequency[3].str() == "2" || matchedFrequency[3].str() == "7") freq += 5;
-				freq25.push_back(freq);
-			}
-			// If modulo 25 leaves a remainder, then it has to be a spec for an 833 frequency
-			else if (freq % 25)
-			{
-				freq833.push_back(freq);
-			}
-			// Otherwise, it could be a spec for either...
-			else
-			{
-				freq25or833.push_back(freq);
-			}
-
-			// Recover the unmatched portion of the string and do it again.
-			str = matchedFrequency.suffix().str();
-		}
-
-		// The frequencies in the 25 list are always good for 25 only sims
-		// They're also good for 833 capable sims if there are no either or 833 only frequencies
-		for (uint32_t f : freq25) frequency.push_back(::make_tuple(f, false));
-		if (freq25or833.size()==0 && freq833.size()==0) for (uint32_t f : freq25) frequency.push_back(::make_tuple(f, true));
-
-		// The frequencies in the either list are always good for 833 capable sims.
-		// They're also good for 25 only sims if there are no 25 only frequencies.
-		for (uint32_t f : freq25or833) frequency.push_back(::make_tuple(f, true));
-		if (freq25.size()==0) for (uint32_t f : freq25or833) frequency.push_back(::make_tuple(f, false));
-
-		// The frequencies in the 833 list are only any use for 833 capable sims.
-		for (uint32_t f : freq833) frequency.push_back(::make_tuple(f, true));
-
-		// If we found frequencies in the string we've just looked at then
-		// don't look at any more.
-		if (frequency.size() > 0)
-		{
-			break;
-		}
-	}
-
-	return frequency;
-}
-
-
-string TS3Channels::getAirportIdentFromString(string str1)
-{
-    const vector<string> strs = { str1 };
-    return getAirportIdentFromStrings(strs);
-}
-
-
-string TS3Channels::getAirportIdentFromStrings(string str1, string str2, string str3)
-{
-    const vector<string> strs = { str1, str2, str3 };
-    return getAirportIdentFromStrings(strs);
-}
-
-string TS3Channels::getAirportIdentFromStrings(const vector<string> &strs)
-{
-    static regex r("[0-9A-Z]{3,7}_(GND|CLD|RCO|CTAF|TWR|RDO|ATF|AWOS|AFIS|ATIS|APP|ARR|DEP|CNTR)");
-
-    smatch matchedIdent;
-    string ident = "";
-
-    for (string str : strs)
-    {
-        if (std::regex_search(str, matchedIdent, r)) {
-            ident = matchedIdent.str();
-            break;
-        }
-    }
-
-    return ident;
-}
-
-tuple<double, double> TS3Channels::getLatLonFromString(string str1)
-{
-    const vector<string> strs = { str1 };
-    return getLatLonFromStrings(strs);
-}
-
-tuple<double, double> TS3Channels::getLatLonFromStrings(string str1, string str2, string str3)
-{
-    const vector<string> strs = { str1, str2, str3 };
-    return getLatLonFromStrings(strs);
-}
-
-tuple<double, double> TS3Channels::getLatLonFromStrings(const vector<string>& strs)
-{
-	static regex r("([NS](?:[1-8]?\\d(?:\\.\\d+)?|90(?:\\.0+)?))\\s*([EW](?:180(?:\\.0+)?|(?:(?:1[0-7]\\d)|(?:[1-9]?\\d))(?:\\.\\d+)?))");
-    //static regex r("([+-]?(?:\\d+\\.?\\d*|\\d*\\.?\\d+))\\s+([+-]?(?:\\d+\\.?\\d*|\\d*\\.?\\d+))");
-
-    tuple<double, double> retVal(999.9, 999.9);
-    double tLat;
-    double tLon;
-
-    smatch matchedLatLon;
-
-    for (string str : strs)
-    {
-        if (std::regex_search(str, matchedLatLon, r)) {
-            string strLat = matchedLatLon[1]; // .str().substr(0, matchedLatLon[1]);
-            string strLon = matchedLatLon[2]; // .str().substr(0, matchedLatLon[2]);
-			tLat = ::stod(strLat.substr(1), NULL) * ((strLat.at(0) == 'S') ? -1 : 1);
-            tLon = ::stod(strLon.substr(1), NULL) * ((strLon.at(0) == 'W') ? -1 : 1);
-
-            retVal = ::make_tuple(tLat, tLon);
-
-            break;
-        }
-    }
-
-    return retVal;
-}
-
-string TS3Channels::concatFreqs(const vector<tuple<uint32_t, bool>>& freqs)
-{
-	stringstream retValue;
-
-	for (tuple<uint32_t, bool> freq : freqs)
-	{
-		if (retValue.tellp() > 0) retValue << ", ";
-		retValue << get<0>(freq) << "/" << get<1>(freq);
-	}
-
-	return retValue.str();
-}
-
-
-
-// Define queries here - they get resolved at compile time...
-const string TS3Channels::aAddInsertChannelFrequency = \
-"insert into channelFrequency(channel, frequency, freq833)" \
-"values" \
-"(:channel, :frequency, :freq833)" \
-";" \
-"";
-
-const string TS3Channels::aAddInsertChannel = \
-"insert into channels (channelId, latitude, longitude, range, parent, ordering, name, station, topic, description)" \
-"values" \
-"(:channelId, :latitude, :longitude, :range, :parent, :order, :name, :station, :topic, :desc)" \
-";" \
-"";
-
-const string TS3Channels::aAddInsertClosure1 = \
-"insert into closure (parent, child, depth)" \
-"values (:child, :child, 0);";
-
-const string TS3Channels::aAddInsertClosure2 = \
-"insert into closure (parent, child, depth)" \
-"select p.parent, c.child, p.depth + c.depth + 1 " \
-"from closure p, closure c " \
-"where p.child = :parent and c.parent = :child" \
-";" \
-"";
-
-uint16_t TS3Channels::addOrUpdateChannel(string& strC, string cName, string cTopic, string cDesc, uint64 channelID, uint64 parentChannel, uint64 order)
-{
-    double lat;
-    double lon;
-    double range;
-    string type;
-
-    bool blIdentFromTS = false;
-    bool blFreqFromTS = false;
-    bool blLatLonFromTS = false;
-    bool blFreqFromDb = false;
-    bool blLatLonFromDb = false;
-
-    string ident = "";
-    vector<tuple<uint32_t, bool>> frequencies;
-    tuple<double, double> latlon;
-
-    // First, delete the channel from the list
-    deleteChannel(channelID);
-
-    // Look for an ident, a frequency and a location, in the data we were passed
-    ident = getAirportIdentFromStrings(cName, cTopic, cDesc);
-    blIdentFromTS = (ident != "");
-
-    frequencies = getFrequenciesFromStrings(cName, cTopic, cDesc);
-    blFreqFromTS = (frequencies.size() != 0);
-
-    latlon = getLatLonFromStrings(cName, cTopic, cDesc);
-    ::tie(lat, lon) = latlon;
-    blLatLonFromTS = (lat != 999.9) && (lon != 999.9);
-    
-    vector<ICAOData::Station> station = icaoData->getStationData(ident);
-
-    if (station.size() > 0)
-    {
-		if (station[0].type == "GND")
-			range = 10.0;
-		else if (station[0].type == "CLD")
-			range = 10.0;
-		else if (station[0].type == "RCO")
-			range = 10.0;
-		else if (station[0].type == "CTAF")
-			range = 50.0;
-		else if (station[0].type == "TWR")
-			range = 50.0;
-		else if (station[0].type == "RDO")
-			range = 50.0;
-		else if (station[0].type == "ATF")
-			range = 50.0;
-		else if (station[0].type == "AWOS")
-			range = 50.0;
-		else if (station[0].type == "AFIS")
-			range = 50.0;
-		else if (station[0].type == "ATIS")
-			range = 400.0;
-		else if (station[0].type == "APP")
-			range = 400.0;
-		else if (station[0].type == "ARR")
-			range = 400.0;
-		else if (station[0].type == "DEP")
-			range = 400.0;
-		else if (station[0].type == "CNTR")
-			range = 1000.0;
-		else if (station[0].type == "OPS")
-			range = 50.0;
-		else if (station[0].type == "AFIS")
-			range = 50.0;
-        else
-            range = 10800.0;
-
-        // If the user hasn't provided the frequencies, then...
-		if (!blFreqFromTS)
-        {
-			// Prepare a list of valid frequencies from all returned stations
-			for (ICAOData::Station st : station)
-			{
-				// freq50 is looking at transmission of ATIS on a NAV frequency - a future enhancement!
-				//bool freq50 = false;
-				bool freq25 = false;
-				bool freq833 = false;
-
-				// First, is it a valid comms frequency
-				if (st.frequency >= 118000 && st.frequency < 137000)
-				{
-					//freq50 = st.frequency % 50 == 0;
-					freq25 = st.frequency % 25 == 0;
-					freq833 = st.frequency % 5 == 0 && st.frequency % 50 != 20 && st.frequency % 50 != 45;
-
-					// Database frequencies are real world therefore if they can be tuned by a 25Khz radio record that,
-					// and if they can also be tuned by a 833Khz radio, record that too.
-					if (freq25) frequencies.push_back(::make_tuple(st.frequency, false));
-					if (freq833) frequencies.push_back(::make_tuple(st.frequency, true));
-				}
-			}
-            blFreqFromDb = true;
-        }
-            
-        if (!blLatLonFromTS)
-        {
-            if (station[0].lat != 999.9 && station[0].lon != 999.9)
-            {
-                lat = station[0].lat;
-                lon = station[0].lon;
-                blLatLonFromDb = true;
-            }
-        }
-    }
-    else
-    {
-        range = 10800.0;
-    }
-
-    int retValue = SQLITE_OK;
-
-    try
-    {
-        SQLite::Transaction aTrans(mChanDb);
-
-		SQLite::Statement aChannelStmt(mChanDb, aAddInsertChannel);
-        SQLite::Statement aClosureStmt1(mChanDb, aAddInsertClosure1);
-        SQLite::Statement aClosureStmt2(mChanDb, aAddInsertClosure2);
-
-        aChannelStmt.bind(":channelId", sqlite3_int64(channelID));
-        (lon != 999.9) ? aChannelStmt.bind(":latitude", lat) : aChannelStmt.bind(":latitude");
-        (lat != 999.9) ? aChannelStmt.bind(":longitude", lon) : aChannelStmt.bind(":longitude");
-        aChannelStmt.bind(":range", range);
-        aChannelStmt.bind(":parent", sqlite3_int64(parentChannel));
-        aChannelStmt.bind(":order", sqlite3_int64(order));
-		aChannelStmt.bind(":name", cName);
-		aChannelStmt.bind(":station", ident);
-        aChannelStmt.bind(":topic", cTopic);
-        aChannelStmt.bind(":desc", cDesc);
-        aChannelStmt.exec();
-
-		// Add all of the frequencies into the channel frequency table.
-		for (::tuple<uint32_t, bool> frequency : frequencies)
-		{
-			SQLite::Statement aChannelFrequencyStmt(mChanDb, aAddInsertChannelFrequency);
-			aChannelFrequencyStmt.bind(":channel", sqlite3_int64(channelID));
-			if (::get<0>(frequency))
-			{
-				aChannelFrequencyStmt.bind(":frequency", ::get<0>(frequency));
-				aChannelFrequencyStmt.bind(":freq833", ::get<1>(frequency));
-			}
-			else
-			{
-				aChannelFrequencyStmt.bind(":frequency");
-				aChannelFrequencyStmt.bind(":freq833");
-			}
-
-			try
-			{
-				aChannelFrequencyStmt.exec();
-			}
-			catch (SQLite::Exception e)
-			{
-				// The statement above will cause a primary key constraint violation if the same frequency is specified twice.
-				// It's safe to ignore that, but anything else should be propagated.
-				if (e.getErrorCode() != SQLITE_CONSTRAINT && e.getExtendedErrorCode() != SQLITE_CONSTRAINT_PRIMARYKEY)
-				{
-					throw(e);
-				}
-			}
-		}
-
-        aClosureStmt1.bind(":child", sqlite3_int64(channelID));
-        aClosureStmt1.exec();
-
-        aClosureStmt2.bind(":parent", sqlite3_int64(parentChannel));
-        aClosureStmt2.bind(":child", sqlite3_int64(channelID));
-		aClosureStmt2.exec();
-
-        aTrans.commit();
-
-        stringstream ssCommentary;
-        ssCommentary << "ChannelID: " << channelID;
-        ssCommentary << " | Name: " << cName;
-        ssCommentary << " | Topic: " << cTopic;
-        ssCommentary << " | Desc: " << cDesc;
-
-        if (blFreqFromDb || blLatLonFromDb)
-            ssCommentary << " | Ident: " << ident;
-
-        if (blFreqFromDb)
-            ssCommentary << " | DBFreq: " << concatFreqs(frequencies);
-        else if (blFreqFromTS)
-            ssCommentary << " | TSFreq: " << concatFreqs(frequencies);
-
-        if (blLatLonFromDb)
-            ssCommentary << " | DBLatLon: " << lat << "/" << lon;
-        else if (blLatLonFromTS)
-            ssCommentary << " | TSLatLon: " << lat << "/" << lon;
-
-        strC = ssCommentary.str();
-    }
-    catch (SQLite::Exception& e)
-    {
-        e;
-        retValue = mChanDb.getErrorCode();
-    }
-    catch (exception& e)
-    {
-        e;
-        retValue = UINT16_MAX;
-    }
-
-    return retValue;
-}
-
-
-const string TS3Channels::aUpdateChannelDescription = \
-"update channels set description = :desc where channelId = :update;" \
-"";
-
-int TS3Channels::updateChannelDescription(string& strC, uint64 channelID, string cDesc)
-{
-	int retValue = SQLITE_OK;
-
-	try
-	{
-		SQLite::Transaction aTrans(mChanDb);
-
-		SQLite::Statement aChannelStmt(mChanDb, aUpdateChannelDescription);
-		aChannelStmt.bind(":update", sqlite3_int64(channelID));
-		aChannelStmt.bind(":desc", cDesc);
-		aChannelStmt.exec();
-
-		aTrans.commit();
-
-		stringstream ssCommentary;
-		ssCommentary << "ChannelID: " << channelID;
-		ssCommentary << " | Desc: " << cDesc;
-
-		strC = ssCommentary.str();
-
-	}
-	catch (SQLite::Exception& e)
-	{
-		e;
-		retValue = mChanDb.getErrorCode();
-	}
-	catch (exception& e)
-	{
-		e;
-		retValue = UINT16_MAX;
-	}
-
-	return retValue;
-
-}
-
-
-
-
-const string TS3Channels::aDeleteChannelFrequencies = \
-"delete from channelFrequency where channel in (" \
-"    select child from closure where parent = :delete" \
-");" \
-"";
-
-const string TS3Channels::aDeleteChannels = \
-"delete from channels where channelId in (" \
-"    select child from closure where parent = :delete" \
-");" \
-"";
-
-const string TS3Channels::aDeleteClosure = \
-"delete from closure where rowid in (" \
-"    select distinct link.rowid " \
-"    from closure p, closure link, closure c, closure to_delete " \
-"    where " \
-"        p.parent = link.parent and " \
-"        c.child = link.child and " \
-"        p.child = to_delete.parent and " \
-"        c.parent = to_delete.child and " \
-"        (to_delete.parent = :delete or to_delete.child = :delete) " \
-"    union " \
-"    select rowid " \
-"    from closure " \
-"    where  " \
-"        parent in (" \
-"        select child from closure where parent = :delete " \
-"        ) " \
-");" \
-"";
-
-int TS3Channels::deleteChannel(uint64 channelID)
-{
-    int retValue = SQLITE_OK;
-
-    try
-    {
-        SQLite::Transaction aTrans(mChanDb);
-
-		SQLite::Statement aChannelFrequencyStmt(mChanDb, aDeleteChannelFrequencies);
-		aChannelFrequencyStmt.bind(":delete", sqlite3_int64(channelID));
-		aChannelFrequencyStmt.exec();
-
-		SQLite::Statement aChannelStmt(mChanDb, aDeleteChannels);
-        aChannelStmt.bind(":delete", sqlite3_int64(channelID));
-        aChannelStmt.exec();
-
-        SQLite::Statement aClosureStmt(mChanDb, aDeleteClosure);
-        aClosureStmt.bind(":delete", sqlite3_int64(channelID));
-        aClosureStmt.exec();
-
-        aTrans.commit();
-    }
-    catch (SQLite::Exception& e)
-    {
-        e;
-        retValue = mChanDb.getErrorCode();
-    }
-
-    return retValue;
-
-}
-
-void TS3Channels::deleteAllChannels(void)
-{
-    // Easier to just do this than play around...
-    initDatabase();
-}
-
-const string TS3Channels::aChannelIsParentOfChild = \
-"select parent from closure where parent = :root and child = :current;";
-
-bool TS3Channels::channelIsUnderRoot(uint64 current, uint64 root)
-{
-	bool retValue = false;
-	SQLite::Statement aStmt2(mChanDb, aChannelIsParentOfChild);
-
-	aStmt2.bind(":current", sqlite3_int64(current));
-	aStmt2.bind(":root", sqlite3_int64(root));
-
-	if (aStmt2.executeStep())
-	{
-		// If the current channel is a child of the selected root, and we
-		// got nothing back from the first query, we're untuned.
-		retValue = true;
-	}
-
-	return retValue;
-}
-
-
-const string TS3Channels::aGetChannelFromFreqCurrPrnt = \
-"with stations as( " \
-"select down.child as channel, up.depth + down.depth as distance, down.depth as removed from " \
-"(select * from closure where child = :current and parent in(select child from closure where parent = :root)) as up, " \
-"(select * from closure as c inner join channelFrequency as cf on c.child = cf.channel and frequency = :frequency and freq833 = :freq833) as down " \
-"where " \
-"up.parent = down.parent " \
-"order by up.depth + down.depth, down.depth desc " \
-"), " \
-"ranges as( " \
-"select s.channel, s.distance, s.removed, c.range as max_range, c.latitude, c.longitude, c.station, ifnull(range(c.latitude, c.longitude, :lat, :lon), c.range) as range " \
-"from stations as s " \
-"left join channels as c " \
-"on s.channel = c.channelId " \
-") " \
-"select r.channel, r.distance, r.removed, r.latitude, r.longitude, r.range, r.max_range, (r.range <= r.max_range) as in_range, r.station " \
-"from ranges r" \
-"";
-
-TS3Channels::StationInfo::StationInfo()
-{
-	ch = CHANNEL_ID_NOT_FOUND;
-	lat = -999.0;
-	lon = -999.0;
-	range = 10800.0;
-	maxRange = 10800.0;
-	in_range = false;
-	id = "";
-}
-
-TS3Channels::StationInfo::StationInfo(uint64 channelID)
-{
-	ch = channelID;
-	lat = -999.0;
-	lon = -999.0;
-	range = 10800.0;
-	maxRange = 10800.0;
-	in_range = false;
-	id = "";
-}
-
-TS3Channels::StationInfo::StationInfo(uint64 pCh, double pLat, double pLon, double pRange, double pMaxR, bool pIn_range, string pStation_id)
-{
-	ch = pCh;
-	lat = pLat;
-	lon = pLon;
-	range = pRange;
-	maxRange = pMaxR;
-	in_range = pIn_range;
-	id = pStation_id;
-}
-
-bool TS3Channels::StationInfo::operator!=(const TS3Channels::StationInfo& rhs) const
-{
-	return this->ch != rhs.ch;
-}
-
-bool TS3Channels::StationInfo::operator==(const TS3Channels::StationInfo& rhs) const
-{
-	return this->ch == rhs.ch;
-}
-
-TS3Channels::StationInfo TS3Channels::getChannelID(uint32_t frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833Capable, double aLat, double aLon)
-{
-    // Define this here - it gets resolved at compile time...
-    // Default scenario is that we don't find a result
-	TS3Channels::StationInfo retValue(CHANNEL_ID_NOT_FOUND);
-	
-    try
-    {
-        string strQuery = aGetChannelFromFreqCurrPrnt +
-            string ((blConsiderRange && blOutOfRangeUntuned) ? " where in_range = 1" : "") +
-            " order by " +
-            string ((blConsiderRange) ? "range, " : "") +
-            "distance, removed;";
-
-        // Create the statement
-        SQLite::Statement aStmt(mChanDb, strQuery);
-
-        // Bind the variables
-        aStmt.bind(":frequency", frequency);
-		aStmt.bind(":freq833", bl833Capable);
-        aStmt.bind(":current", sqlite3_int64(current));
-        aStmt.bind(":root", sqlite3_int64(root));
-        aStmt.bind(":lat", aLat);
-        aStmt.bind(":lon", aLon);
-
-        // Execute the query, and if we get a result.
-        if (aStmt.executeStep())
-        {
-            // The query is written to return the station to be tuned in the first row.
-			retValue = StationInfo(
-				aStmt.getColumn(0).getInt64(),
-				aStmt.getColumn(3).getDouble(),
-				aStmt.getColumn(4).getDouble(),
-				aStmt.getColumn(5).getDouble(),
-				aStmt.getColumn(6).getDouble(),
-				aStmt.getColumn(7).getInt() != 0,
-				aStmt.getColumn(8).getString()
-				);
-        }
-        else
-        {
-            if (channelIsUnderRoot(current, root))
-            {
-                // If the current channel is a child of the selected root, then
-				// we can't find a matching channel ID, so say so.
-                retValue = TS3Channels::StationInfo(CHANNEL_ID_NOT_FOUND);
-            }
-            else
-            {
-				// If the current channel is not a child of the root, then flag
-				// us as being outide of the root.
-				retValue = TS3Channels::StationInfo(CHANNEL_NOT_CHILD_OF_ROOT);
-            }
-        }
-    }
-    catch (SQLite::Exception&)
-    {
-        // If anything goes wrong (it shouldn't) then we've not found a frequency.
-        retValue = TS3Channels::StationInfo(CHANNEL_ID_NOT_FOUND);
-    }
-
-    return retValue;
-
-}
-
-// Returns the ID of the channel corresponding to a frequency provided as a double.
-TS3Channels::StationInfo TS3Channels::getChannelID(double frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833capable, double aLat, double aLon)
-{
-    // Need to get the rounding right
-    // Try 128.300 to see why this is needed!
-    return getChannelID(uint32_t(0.1 * round(1000 * frequency)), current, root, blConsiderRange, blOutOfRangeUntuned, bl833capable, aLat, aLon);
-}
-
-
-TS3Channels::ChannelInfo::ChannelInfo(uint64 ch, int d, string str)
-{
-    channelID = ch;
-    depth = d;
-    name = str;
-}
-
-
-const string TS3Channels::aGetChannelList = \
-"with recursive sort(channelId, parentId, indx, ordering, name) as " \
-"( " \
-"    select channelId, parent, 0, ordering, name from channels where channelId = 0 " \
-"    union " \
-"    select ch.channelId, ch.parent, sort.indx + 1, ch.ordering, ch.name " \
-"    from channels ch " \
-"    inner join sort on ch.ordering = sort.channelId " \
-"    where ch.channelId <> 0 " \
-"    limit 1000000 " \
-"), " \
-"tree(channelId, depth, path, name) as " \
-"( " \
-"    select channelId, 0, printf(\"%08p\", indx), name from sort where channelId = :root " \
-"    union " \
-"    select ch.channelId, tree.depth + 1, tree.path || printf(\" %08p\", ch.indx), ch.name " \
-"    from " \
-"    sort ch " \
-"    inner join tree on ch.parentId = tree.channelId " \
-"    where ch.channelId <> 0 " \
-"    limit 1000000 " \
-") " \
-"select channelId, depth, name from tree order by path; " \
-"";
-
-vector<TS3Channels::ChannelInfo> TS3Channels::getChannelList(uint64 root)
-{
-    vector<TS3Channels::ChannelInfo> retValue;
-
-    try
-    {
-        // Create the statement
-        SQLite::Statement aStmt(mChanDb, aGetChannelList);
-
-        // Bind the variables
-        aStmt.bind(":root", sqlite3_int64(root));
-
-        while (aStmt.executeStep())
-        // Execute the query, and if we get a result.
-        {
-            uint64 channelID;
-            int depth;
-            string name;
-
-            // The query is written to return a single value in a single row...
-            channelID = aStmt.getColumn(0).getInt64();
-            depth = aStmt.getColumn(1).getInt();
-            name = aStmt.getColumn(2).getText();
-
-            ChannelInfo ch(channelID, depth, name);
-
-            retValue.push_back(ch);
-        }
-    }
-    catch (SQLite::Exception& e)
-    {
-        e;
-    }
-    catch (exception& e)
-    {
-        e;
-    }
-    return retValue;
-}
-
-#define DEG2RAD(degrees) (degrees * 0.01745327) // degrees * pi over 180
-
-void TS3Channels::distanceFunc(sqlite3_context *context, int argc, sqlite3_value **argv)
-{
-    // check that we have four arguments (lat1, lon1, lat2, lon2)
-
-    // check that all four arguments are non-null
-    if (sqlite3_value_type(argv[0]) == SQLITE_NULL || sqlite3_value_type(argv[1]) == SQLITE_NULL || sqlite3_value_type(argv[2]) == SQLITE_NULL || sqlite3_value_type(argv[3]) == SQLITE_NULL) {
-        sqlite3_result_null(context);
-        return;
-    }
-    // get the four argument values
-    double lat1 = sqlite3_value_double(argv[0]);
-    double lon1 = sqlite3_value_double(argv[1]);
-    double lat2 = sqlite3_value_double(argv[2]);
-    double lon2 = sqlite3_value_double(argv[3]);
-
-	double distance = getDistanceBetweenLatLonInNm(lat1, lon1, lat2, lon2);
-
-	sqlite3_result_double(context, distance);
-
-}
-
-double TS3Channels::getDistanceBetweenLatLonInNm(double lat1, double lon1, double lat2, double lon2)
-{
-	// convert lat1 and lat2 into radians now, to avoid doing it twice below
-	double lat1rad = DEG2RAD(lat1);
-	double lat2rad = DEG2RAD(lat2);
-	
-	// apply the spherical law of cosines to our latitudes and longitudes, and set the result appropriately
-	// 3437.746 is the approximate radius of the earth in nautical miles
-	double result = acos(sin(lat1rad) * sin(lat2rad) + cos(lat1rad) * cos(lat2rad) * cos(DEG2RAD(lon2) - DEG2RAD(lon1))) * 3437.746;
-
-	return result;
-}
+#include <regex>
+#include <algorithm>
+#include <string>
+#include <map>
+#include <unordered_set>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+#include <cmath>
+
+#if defined(_WIN32)
+#include <ShlObj.h>
+#endif
+
+#include <SQLiteCpp/Transaction.h>
+
+#include "TS3Channels.h"
+#include "ICAOData.h"
+#include "BFSGSimCom.h"
+#include "Geo.h"
+
+using namespace std;
+
+// Shared by the channels for every server connection. It's swapped rather than changed when it's reloaded,
+// so anything still parsing against the old data can finish with it.
+shared_ptr<ICAOData> icaoData;
+
+string TS3Channels::determineChanDbFileName(void)
+{
+    string retValue = "";
+
+#if defined(_DEBUG) && defined(_WIN32)
+    WCHAR* wpath = NULL;
+    char cpath[_MAX_PATH];
+    char defChar = ' ';
+
+    if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_Documents, 0, NULL, &wpath)))
+    {
+        int rc = WideCharToMultiByte(CP_ACP, 0, wpath, -1, cpath, _MAX_PATH, &defChar, NULL);
+
+        // Each server connection has its own channels, so give each its own file.
+        static int instances = 0;
+        stringstream ssFileName;
+        ssFileName << cpath << "\\bfsgsimcom";
+        if (instances++ > 0) ssFileName << "-" << instances;
+        ssFileName << ".db3";
+
+        retValue = ssFileName.str();
+
+        CoTaskMemFree(static_cast<void*>(wpath));
+    }
+
+#else
+    retValue = ":memory:";
+#endif
+
+    return retValue;
+}
+
+// Constructor for the TS3 channel class
+TS3Channels::TS3Channels(bool compact) :
+    mChanDbFileName(determineChanDbFileName()),
+    mChanDb(TS3Channels::mChanDbFileName, SQLITE_OPEN_CREATE | SQLITE_OPEN_READWRITE),
+    mSnapshots(new ChannelIndex()),
+    mTuningWanted(TuningTable::NO_ROOT),
+    mRebuilding(false),
+    mBatching(false),
+    mReparse(false),
+    mGeneration(0),
+    mSource(""),
+    mReady(false),
+    mCompact(compact),
+    mKernel(0),
+    mParser(new ParsePool<Parsed>([this](vector<Parsed>& batch) { commitParsed(batch); }))
+{
+	if (atomic_load(&icaoData) == NULL) atomic_store(&icaoData, make_shared<ICAOData>());
+    initDatabase();
+    initChannelTables();
+}
+
+TS3Channels::~TS3Channels()
+{
+}
+
+void TS3Channels::setTextSource(TextSource source)
+{
+    lock_guard<mutex> lock(mWriteLock);
+    mTextSource = source;
+}
+
+// The raw topic and description of a channel, for diagnostics. They're only kept if storage isn't compact,
+// otherwise they have to be asked for.
+bool TS3Channels::getChannelText(uint64 channelID, string& topic, string& description)
+{
+    TextSource source;
+
+    {
+        Snapshot snapshot(mSnapshots);
+        const ChannelIndex::Channel* channel = snapshot->getChannel(channelID);
+        if (channel == NULL) return false;
+
+        if (channel->text != NULL)
+        {
+            topic = channel->getTopic();
+            description = channel->getDescription();
+            return true;
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(mWriteLock);
+        source = mTextSource;
+    }
+
+    return source && source(channelID, topic, description);
+}
+
+int TS3Channels::initDatabase()
+{
+    int retValue = SQLITE_OK;
+
+	static const string aInitDatabase = \
+		"DROP TABLE IF EXISTS main.channels;" \
+		"DROP TABLE IF EXISTS main.closure;" \
+		"DROP TABLE IF EXISTS main.channelFrequency;" \
+		"CREATE TABLE IF NOT EXISTS main.channels(" \
+		"   channelId UNSIGNED BIG INT PRIMARY KEY NOT NULL, "  \
+		"   latitude DOUBLE, " \
+		"   longitude DOUBLE, " \
+		"   range DOUBLE, " \
+		"   parent UNSIGNED BIG INT, "  \
+		"   ordering UNSIGNED BIG INT, "  \
+		"   name CHAR(256)," \
+		"   station CHAR(16)," \
+		"   topic CHAR(256)," \
+		"   description TEXT," \
+		"   FOREIGN KEY (parent) REFERENCES channels (channelId)" \
+		"); " \
+		"create table if not exists main.closure(" \
+		"   parent unsigned big int not null," \
+		"   child unsigned big int not null," \
+		"   depth int not null" \
+		");" \
+		"create table if not exists main.channelFrequency(" \
+		"   channel UNSIGNED BIG INT NOT NULL," \
+		"   frequency INT," \
+		"   freq833 INT," \
+		"   PRIMARY KEY (channel, frequency, freq833)," \
+		"   FOREIGN KEY (channel) REFERENCES channels (channelId)"
+		");" \
+		"create unique index if not exists main.closureprntchld on closure(parent, child, depth);" \
+		"create unique index if not exists main.closurechldprnt on closure(child, parent, depth);" \
+		"create index main.parent_idx on channels(parent);" \
+		"delete from main.channels;" \
+		"delete from main.closure;" \
+		"delete from main.channelFrequency;" \
+        "insert into main.channels(channelId, latitude, longitude, range, parent, ordering, name, station, topic, description) values (0, null, null, null, 0, 0, 'Root', 'Root Channel', 'Root Channel', 'Root Channel');"
+        "insert into main.closure(parent, child, depth) values (0, 0, 0);" \
+        "";
+
+    lock_guard<mutex> lock(mWriteLock);
+
+    mIndex.clear();
+    publish();
+
+    try
+    {
+        mChanDb.exec(aInitDatabase);
+    }
+    catch (SQLite::Exception& e)
+    {
+        e;
+        retValue = mChanDb.getErrorCode();
+    }
+
+    sqlite3_create_function(mChanDb.getHandle(), "range", 4, SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, &distanceFunc, NULL, NULL);
+
+    return retValue;
+}
+
+// The tables in the database file are only ever a copy - these are the real thing, read straight from the
+// published channels. Being temporary, they're found before the copies by anything that doesn't say which.
+const string TS3Channels::aCreateChannelTables = \
+"create virtual table if not exists temp.channels using bfsg_channels;" \
+"create virtual table if not exists temp.channelFrequency using bfsg_channel_frequency;" \
+"create virtual table if not exists temp.closure using bfsg_closure;" \
+"";
+
+int TS3Channels::initChannelTables(void)
+{
+    int retValue = ChannelTables::registerModules(mChanDb.getHandle(), &mSnapshots);
+
+    try
+    {
+        if (retValue == SQLITE_OK) mChanDb.exec(aCreateChannelTables);
+    }
+    catch (SQLite::Exception& e)
+    {
+        e;
+        retValue = mChanDb.getErrorCode();
+    }
+
+    return retValue;
+}
+
+const string TS3Channels::aMaterialiseChannels = \
+"delete from main.channels;" \
+"delete from main.closure;" \
+"delete from main.channelFrequency;" \
+"insert or ignore into main.channels select * from temp.channels;" \
+"insert or ignore into main.channelFrequency select * from temp.channelFrequency;" \
+"insert or ignore into main.closure select * from temp.closure;" \
+"";
+
+void TS3Channels::materialise(void)
+{
+    try
+    {
+        SQLite::Transaction aTrans(mChanDb);
+        mChanDb.exec(aMaterialiseChannels);
+        aTrans.commit();
+    }
+    catch (SQLite::Exception& e)
+    {
+        // The database is only there to look at - the index is what counts.
+        e;
+    }
+}
+
+// Makes the current state of the master index visible to readers. Must be called with the write lock held.
+void TS3Channels::publish(void)
+{
+    // Nothing is visible until a rebuild or a batch is complete.
+    if (mRebuilding || mBatching) return;
+
+    // Versions are unique across every server connection, so a version is enough to tell two snapshots apart.
+    static atomic<uint64> versions(0);
+    mIndex.setVersion(++versions);
+    mIndex.refreshTuning();
+    mSnapshots.publish(new ChannelIndex(mIndex));
+
+    // Whatever table was wanted has been built by now, if it's going to be.
+    mTuningWanted = TuningTable::NO_ROOT;
+}
+
+
+// The cache file for a server is named after a hash of its unique identifier, which isn't safe to use in a file name.
+string TS3Channels::determineCacheFileName(const string& source)
+{
+    stringstream ssFileName;
+    ssFileName << pluginPath << "BFSGSimCom_plugin/channels-" << hex << setw(16) << setfill('0') << fingerprint(source, "", "", 0, 0) << ".cache";
+
+    return ssFileName.str();
+}
+
+static const char aCacheMagic[8] = { 'B', 'F', 'S', 'G', 'C', 'H', 'N', 'L' };
+
+// Bump this whenever the layout or the parsing changes, so that old caches are ignored.
+static const uint32_t aCacheVersion = 1;
+
+static void writeCacheString(ostream& out, const string& str)
+{
+    uint32_t len = uint32_t(str.length());
+    out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    out.write(str.data(), len);
+}
+
+static bool readCacheString(istream& in, string& str)
+{
+    uint32_t len;
+    if (!in.read(reinterpret_cast<char*>(&len), sizeof(len)) || len > 1048576) return false;
+
+    str.resize(len);
+    return len == 0 || bool(in.read(&str[0], len));
+}
+
+template <class T> static void writeCacheValue(ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class T> static bool readCacheValue(istream& in, T& value)
+{
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+// Starts from the channels saved the last time we were connected to this server. They're published
+// straight away, and a rebuild then only needs to fetch the channels which have changed since.
+bool TS3Channels::loadCache(const string& source)
+{
+    if (source == "") return false;
+
+    ifstream in(determineCacheFileName(source), ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(aCacheMagic)];
+    uint32_t version;
+    string cachedSource;
+    uint64 count;
+
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, aCacheMagic, sizeof(magic)) != 0) return false;
+    if (!readCacheValue(in, version) || version != aCacheVersion) return false;
+    if (!readCacheString(in, cachedSource) || cachedSource != source) return false;
+    if (!readCacheValue(in, count)) return false;
+
+    ChannelIndex loaded;
+
+    for (uint64 i = 0; i < count; i++)
+    {
+        shared_ptr<ChannelIndex::Channel> channel = make_shared<ChannelIndex::Channel>();
+        uint8_t hasLatLon;
+        uint32_t frequencies;
+        string name, station, topic, description;
+
+        if (!readCacheValue(in, channel->channelID) ||
+            !readCacheValue(in, channel->parent) ||
+            !readCacheValue(in, channel->order) ||
+            !readCacheValue(in, channel->lat) ||
+            !readCacheValue(in, channel->lon) ||
+            !readCacheValue(in, hasLatLon) ||
+            !readCacheValue(in, channel->range) ||
+            !readCacheString(in, name) ||
+            !readCacheString(in, station) ||
+            !readCacheString(in, topic) ||
+            !readCacheString(in, description) ||
+            !readCacheValue(in, channel->fingerprint) ||
+            !readCacheValue(in, channel->header) ||
+            !readCacheValue(in, frequencies) ||
+            frequencies > 1024)
+            return false;
+
+        channel->hasLatLon = (hasLatLon != 0);
+        channel->name = StringArena::shared().intern(name);
+        channel->station = StringArena::shared().intern(station);
+
+        // A cache saved with full storage can still be loaded in compact storage, it just loses the text.
+        if (!mCompact && (topic != "" || description != ""))
+        {
+            shared_ptr<ChannelIndex::Text> text = make_shared<ChannelIndex::Text>();
+            text->topic = topic;
+            text->description = description;
+            channel->text = text;
+        }
+
+        for (uint32_t f = 0; f < frequencies; f++)
+        {
+            uint32_t frequency;
+            uint8_t freq833;
+
+            if (!readCacheValue(in, frequency) || !readCacheValue(in, freq833)) return false;
+            channel->frequencies.push_back(::make_tuple(frequency, freq833 != 0));
+        }
+
+        if (channel->channelID != CHANNEL_ROOT) loaded.addOrUpdate(channel);
+    }
+
+    lock_guard<mutex> lock(mWriteLock);
+
+    // Only ever a starting point - never replace anything we've already loaded.
+    if (mRebuilding || mGeneration > 0) return false;
+
+    mIndex = loaded;
+    mSource = source;
+    mGeneration++;
+
+    publish();
+    mReady = true;
+
+    return true;
+}
+
+// Saves the last complete generation for next time. It's written alongside and then moved into place,
+// so a crash part way through can't leave a broken cache.
+bool TS3Channels::saveCache(void)
+{
+    Snapshot snapshot(mSnapshots);
+    string source;
+
+    {
+        lock_guard<mutex> lock(mWriteLock);
+        source = mSource;
+    }
+
+    if (source == "" || !mReady) return false;
+
+    string fileName = determineCacheFileName(source);
+    string tempFileName = fileName + ".tmp";
+
+    {
+        ofstream out(tempFileName, ios::binary | ios::trunc);
+        if (!out) return false;
+
+        out.write(aCacheMagic, sizeof(aCacheMagic));
+        writeCacheValue(out, aCacheVersion);
+        writeCacheString(out, source);
+        writeCacheValue(out, uint64(snapshot->getChannels().size()));
+
+        for (const auto& entry : snapshot->getChannels())
+        {
+            const ChannelIndex::Channel& channel = *entry.second;
+
+            writeCacheValue(out, channel.channelID);
+            writeCacheValue(out, channel.parent);
+            writeCacheValue(out, channel.order);
+            writeCacheValue(out, channel.lat);
+            writeCacheValue(out, channel.lon);
+            writeCacheValue(out, uint8_t(channel.hasLatLon ? 1 : 0));
+            writeCacheValue(out, channel.range);
+            writeCacheString(out, channel.name);
+            writeCacheString(out, channel.station);
+            writeCacheString(out, channel.getTopic());
+            writeCacheString(out, channel.getDescription());
+            writeCacheValue(out, channel.fingerprint);
+            writeCacheValue(out, channel.header);
+            writeCacheValue(out, uint32_t(channel.frequencies.size()));
+
+            for (const tuple<uint32_t, bool>& frequency : channel.frequencies)
+            {
+                writeCacheValue(out, ::get<0>(frequency));
+                writeCacheValue(out, uint8_t(::get<1>(frequency) ? 1 : 0));
+            }
+        }
+
+        if (!out.flush()) return false;
+    }
+
+#if defined(_WIN32)
+    return MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    // rename replaces the old file in one step everywhere else.
+    return rename(tempFileName.c_str(), fileName.c_str()) == 0;
+#endif
+}
+
+
+vector<tuple<uint32_t, bool>> TS3Channels::getFrequenciesFromString(string str1)
+{
+	const vector<string> strs = { str1 };
+	return getFrequenciesFromStrings(strs);
+}
+
+
+vector<tuple<uint32_t, bool>> TS3Channels::getFrequenciesFromStrings(string str1, string str2, string str3)
+{
+	const vector<string> strs = { str1, str2, str3 };
+	return getFrequenciesFromStrings(strs);
+}
+
+
+vector<tuple<uint32_t, bool>> TS3Channels::getFrequenciesFromStrings(const vector<string> &strs)
+{
+	// A valid frequency is quite complicated!.
+	// This first one also matches nav frequencies for when ATIS is transmitted on them. Future enhancement!
+	//static regex r("(1((?:(?:(?:0[89])|(?:1[0-7]))\\.[0-9][05]?0?)|(?:(?:1[89]|2[0-9]|3[0-6])\\.(?:[0-9](?:(?:(?:(?:0|1|3|4|5|6|8|9)0)|(?:(?:0|1|2|3|5|6|7|8)5)|[0257]))))))\\s*");
+	static regex r("(1(?:(?:(?:1[89]|2[0-9]|3[0-6])\\.(?:[0-9](?:(?:((?:(?:0|1|3|4|5|6|8|9)0)|(?:(?:0|1|2|3|5|6|7|8)5))|([0257])))))))\\s*");
+
+	smatch matchedFrequency;
+	vector<tuple<uint32_t, bool>> frequency;
+
+	// Intermediate lists of discovered frequencies
+	vector<uint32_t> freq25;
+	vector<uint32_t> freq25or833;
+	vector<uint32_t> freq833;
+	
+	//Iterating through each string in the vector we were sent.
+	for (string str : strs)
+	{
+		// Look for all frequencies in the string.
+		while (std::regex_search(str, matchedFrequency, r)) {
+
+			string freq_str = matchedFrequency[1].str();
+			uint32_t freq = uint32_t(1000 * std::stod(freq_str) + 0.5);
+
+			// Categorise the frequency we found...
+			// If there are only two DP, then it's 25 only = for now.
+			if (matchedFrequency[3].str().length() > 0)
+			{
+				// If the last digit is a 2 or a 7, then it should be 25 or 75 really.
+				if (matchedFrequency[3].str() == "2" || matchedFrequency[3].str() == "7") freq += 5;
+				freq25.push_back(freq);
+			}
+			// If modulo 25 leaves a remainder, then it has to be a spec for an 833 frequency
+			else if (freq % 25)
+			{
+				freq833.push_back(freq);
+			}
+			// Otherwise, it could be a spec for either...
+			else
+			{
+				freq25or833.push_back(freq);
+			}
+
+			// Recover the unmatched portion of the string and do it again.
+			str = matchedFrequency.suffix().str();
+		}
+
+		// The frequencies in the 25 list are always good for 25 only sims
+		// They're also good for 833 capable sims if there are no either or 833 only frequencies
+		for (uint32_t f : freq25) frequency.push_back(::make_tuple(f, false));
+		if (freq25or833.size()==0 && freq833.size()==0) for (uint32_t f : freq25) frequency.push_back(::make_tuple(f, true));
+
+		// The frequencies in the either list are always good for 833 capable sims.
+		// They're also good for 25 only sims if there are no 25 only frequencies.
+		for (uint32_t f : freq25or833) frequency.push_back(::make_tuple(f, true));
+		if (freq25.size()==0) for (uint32_t f : freq25or833) frequency.push_back(::make_tuple(f, false));
+
+		// The frequencies in the 833 list are only any use for 833 capable sims.
+		for (uint32_t f : freq833) frequency.push_back(::make_tuple(f, true));
+
+		// If we found frequencies in the string we've just looked at then
+		// don't look at any more.
+		if (frequency.size() > 0)
+		{
+			break;
+		}
+	}
+
+	return frequency;
+}
+
+
+string TS3Channels::getAirportIdentFromString(string str1)
+{
+    const vector<string> strs = { str1 };
+    return getAirportIdentFromStrings(strs);
+}
+
+
+string TS3Channels::getAirportIdentFromStrings(string str1, string str2, string str3)
+{
+    const vector<string> strs = { str1, str2, str3 };
+    return getAirportIdentFromStrings(strs);
+}
+
+string TS3Channels::getAirportIdentFromStrings(const vector<string> &strs)
+{
+    static regex r("[0-9A-Z]{3,7}_(GND|CLD|RCO|CTAF|TWR|RDO|ATF|AWOS|AFIS|ATIS|APP|ARR|DEP|CNTR)");
+
+    smatch matchedIdent;
+    string ident = "";
+
+    for (string str : strs)
+    {
+        if (std::regex_search(str, matchedIdent, r)) {
+            ident = matchedIdent.str();
+            break;
+        }
+    }
+
+    return ident;
+}
+
+tuple<double, double> TS3Channels::getLatLonFromString(string str1)
+{
+    const vector<string> strs = { str1 };
+    return getLatLonFromStrings(strs);
+}
+
+tuple<double, double> TS3Channels::getLatLonFromStrings(string str1, string str2, string str3)
+{
+    const vector<string> strs = { str1, str2, str3 };
+    return getLatLonFromStrings(strs);
+}
+
+tuple<double, double> TS3Channels::getLatLonFromStrings(const vector<string>& strs)
+{
+	static regex r("([NS](?:[1-8]?\\d(?:\\.\\d+)?|90(?:\\.0+)?))\\s*([EW](?:180(?:\\.0+)?|(?:(?:1[0-7]\\d)|(?:[1-9]?\\d))(?:\\.\\d+)?))");
+    //static regex r("([+-]?(?:\\d+\\.?\\d*|\\d*\\.?\\d+))\\s+([+-]?(?:\\d+\\.?\\d*|\\d*\\.?\\d+))");
+
+    tuple<double, double> retVal(999.9, 999.9);
+    double tLat;
+    double tLon;
+
+    smatch matchedLatLon;
+
+    for (string str : strs)
+    {
+        if (std::regex_search(str, matchedLatLon, r)) {
+            string strLat = matchedLatLon[1]; // .str().substr(0, matchedLatLon[1]);
+            string strLon = matchedLatLon[2]; // .str().substr(0, matchedLatLon[2]);
+			tLat = ::stod(strLat.substr(1), NULL) * ((strLat.at(0) == 'S') ? -1 : 1);
+            tLon = ::stod(strLon.substr(1), NULL) * ((strLon.at(0) == 'W') ? -1 : 1);
+
+            retVal = ::make_tuple(tLat, tLon);
+
+            break;
+        }
+    }
+
+    return retVal;
+}
+
+// Produces a 64 bit FNV-1a hash of everything which goes into parsing a channel. Each string is
+// terminated by its length so that text can't move between fields without changing the result.
+uint64 TS3Channels::fingerprint(const string& cName, const string& cTopic, const string& cDesc, uint64 parentChannel, uint64 order)
+{
+	uint64 hash = 14695981039346656037ULL;
+
+	auto addBytes = [&hash](const void* data, size_t len)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < len; i++)
+		{
+			hash ^= p[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	for (const string* str : { &cName, &cTopic, &cDesc })
+	{
+		uint64 len = str->length();
+		addBytes(str->data(), str->length());
+		addBytes(&len, sizeof(len));
+	}
+
+	addBytes(&parentChannel, sizeof(parentChannel));
+	addBytes(&order, sizeof(order));
+
+	return hash;
+}
+
+string TS3Channels::concatFreqs(const vector<tuple<uint32_t, bool>>& freqs)
+{
+	stringstream retValue;
+
+	for (tuple<uint32_t, bool> freq : freqs)
+	{
+		if (retValue.tellp() > 0) retValue << ", ";
+		retValue << get<0>(freq) << "/" << get<1>(freq);
+	}
+
+	return retValue.str();
+}
+
+
+
+// Queues a channel to be parsed on the parse pool, unless nothing that goes into parsing it has changed since
+// it was last loaded. Either way, done is called with the commentary once the channel is in the index.
+void TS3Channels::queueChannel(string cName, string cTopic, string cDesc, uint64 channelID, uint64 parentChannel, uint64 order, function<void(const string&)> done)
+{
+    uint64 channelFingerprint = fingerprint(cName, cTopic, cDesc, parentChannel, order);
+
+    {
+        lock_guard<mutex> lock(mWriteLock);
+
+        if (mRebuilding) mRebuildSeen.insert(channelID);
+
+        // Anything still waiting to be parsed is what the channel is about to be, whatever the index says.
+        auto pending = mPending.find(channelID);
+        const ChannelIndex::Channel* existing = mIndex.getChannel(channelID);
+
+        bool unchanged = (pending != mPending.end()) ? (pending->second.fingerprint == channelFingerprint) : (existing != NULL && existing->fingerprint == channelFingerprint);
+        if (!mReparse && unchanged)
+        {
+            mStatistics.skipped++;
+
+            stringstream ssCommentary;
+            ssCommentary << "ChannelID: " << channelID << " | Unchanged - not reparsed";
+            if (done) done(ssCommentary.str());
+
+            return;
+        }
+
+        Pending& queued = mPending[channelID];
+        queued.fingerprint = channelFingerprint;
+        queued.queued++;
+    }
+
+    mParser->submit([=]()
+    {
+        Parsed parsed = parseChannel(cName, cTopic, cDesc, channelID, parentChannel, order, channelFingerprint);
+        parsed.channelID = channelID;
+        parsed.done = done;
+        return parsed;
+    },
+    [=](const string& error)
+    {
+        Parsed parsed = failedParse(channelID, error, done);
+        parsed.channelID = channelID;
+        return parsed;
+    });
+}
+
+uint16_t TS3Channels::addOrUpdateChannel(string& strC, string cName, string cTopic, string cDesc, uint64 channelID, uint64 parentChannel, uint64 order)
+{
+    queueChannel(cName, cTopic, cDesc, channelID, parentChannel, order, [&strC](const string& commentary) { strC = commentary; });
+    mParser->wait();
+
+    return SQLITE_OK;
+}
+
+// Works out everything we need from a channel. It only depends on what it's given and the ICAO data, so
+// any number of channels can be parsed at once, and the result is the same whatever order they run in.
+TS3Channels::Parsed TS3Channels::parseChannel(const string& cName, const string& cTopic, const string& cDesc, uint64 channelID, uint64 parentChannel, uint64 order, uint64 channelFingerprint)
+{
+    double lat;
+    double lon;
+    double range;
+    string type;
+
+    bool blIdentFromTS = false;
+    bool blFreqFromTS = false;
+    bool blLatLonFromTS = false;
+    bool blFreqFromDb = false;
+    bool blLatLonFromDb = false;
+
+    string ident = "";
+    vector<tuple<uint32_t, bool>> frequencies;
+    tuple<double, double> latlon;
+
+    Parsed retValue;
+
+    // Look for an ident, a frequency and a location, in the data we were passed
+    ident = getAirportIdentFromStrings(cName, cTopic, cDesc);
+    blIdentFromTS = (ident != "");
+
+    frequencies = getFrequenciesFromStrings(cName, cTopic, cDesc);
+    blFreqFromTS = (frequencies.size() != 0);
+
+    latlon = getLatLonFromStrings(cName, cTopic, cDesc);
+    ::tie(lat, lon) = latlon;
+    blLatLonFromTS = (lat != 999.9) && (lon != 999.9);
+    
+    vector<ICAOData::Station> station = atomic_load(&icaoData)->getStationData(ident);
+
+    if (station.size() > 0)
+    {
+		if (station[0].type == "GND")
+			range = 10.0;
+		else if (station[0].type == "CLD")
+			range = 10.0;
+		else if (station[0].type == "RCO")
+			range = 10.0;
+		else if (station[0].type == "CTAF")
+			range = 50.0;
+		else if (station[0].type == "TWR")
+			range = 50.0;
+		else if (station[0].type == "RDO")
+			range = 50.0;
+		else if (station[0].type == "ATF")
+			range = 50.0;
+		else if (station[0].type == "AWOS")
+			range = 50.0;
+		else if (station[0].type == "AFIS")
+			range = 50.0;
+		else if (station[0].type == "ATIS")
+			range = 400.0;
+		else if (station[0].type == "APP")
+			range = 400.0;
+		else if (station[0].type == "ARR")
+			range = 400.0;
+		else if (station[0].type == "DEP")
+			range = 400.0;
+		else if (station[0].type == "CNTR")
+			range = 1000.0;
+		else if (station[0].type == "OPS")
+			range = 50.0;
+		else if (station[0].type == "AFIS")
+			range = 50.0;
+        else
+            range = 10800.0;
+
+        // If the user hasn't provided the frequencies, then...
+		if (!blFreqFromTS)
+        {
+			// Prepare a list of valid frequencies from all returned stations
+			for (ICAOData::Station st : station)
+			{
+				// freq50 is looking at transmission of ATIS on a NAV frequency - a future enhancement!
+				//bool freq50 = false;
+				bool freq25 = false;
+				bool freq833 = false;
+
+				// First, is it a valid comms frequency
+				if (st.frequency >= 118000 && st.frequency < 137000)
+				{
+					//freq50 = st.frequency % 50 == 0;
+					freq25 = st.frequency % 25 == 0;
+					freq833 = st.frequency % 5 == 0 && st.frequency % 50 != 20 && st.frequency % 50 != 45;
+
+					// Database frequencies are real world therefore if they can be tuned by a 25Khz radio record that,
+					// and if they can also be tuned by a 833Khz radio, record that too.
+					if (freq25) frequencies.push_back(::make_tuple(st.frequency, false));
+					if (freq833) frequencies.push_back(::make_tuple(st.frequency, true));
+				}
+			}
+            blFreqFromDb = true;
+        }
+            
+        if (!blLatLonFromTS)
+        {
+            if (station[0].lat != 999.9 && station[0].lon != 999.9)
+            {
+                lat = station[0].lat;
+                lon = station[0].lon;
+                blLatLonFromDb = true;
+            }
+        }
+    }
+    else
+    {
+        range = 10800.0;
+    }
+
+    try
+    {
+        shared_ptr<ChannelIndex::Channel> channel = make_shared<ChannelIndex::Channel>(channelID);
+
+        channel->parent = parentChannel;
+        channel->order = order;
+        channel->hasLatLon = (lat != 999.9) && (lon != 999.9);
+        channel->lat = channel->hasLatLon ? lat : 0.0;
+        channel->lon = channel->hasLatLon ? lon : 0.0;
+        channel->range = range;
+        channel->name = StringArena::shared().intern(cName);
+        channel->station = StringArena::shared().intern(ident);
+        channel->frequencies = frequencies;
+        channel->fingerprint = channelFingerprint;
+        channel->header = fingerprint(cName, cTopic, "", parentChannel, order);
+
+        if (!mCompact)
+        {
+            shared_ptr<ChannelIndex::Text> text = make_shared<ChannelIndex::Text>();
+            text->topic = cTopic;
+            text->description = cDesc;
+            channel->text = text;
+        }
+
+        stringstream ssCommentary;
+        ssCommentary << "ChannelID: " << channelID;
+        ssCommentary << " | Name: " << cName;
+        ssCommentary << " | Topic: " << cTopic;
+        ssCommentary << " | Desc: " << cDesc;
+
+        if (blFreqFromDb || blLatLonFromDb)
+            ssCommentary << " | Ident: " << ident;
+
+        if (blFreqFromDb)
+            ssCommentary << " | DBFreq: " << concatFreqs(frequencies);
+        else if (blFreqFromTS)
+            ssCommentary << " | TSFreq: " << concatFreqs(frequencies);
+
+        if (blLatLonFromDb)
+            ssCommentary << " | DBLatLon: " << lat << "/" << lon;
+        else if (blLatLonFromTS)
+            ssCommentary << " | TSLatLon: " << lat << "/" << lon;
+
+        retValue.channel = channel;
+        retValue.commentary = ssCommentary.str();
+    }
+    catch (exception& e)
+    {
+        retValue = failedParse(channelID, e.what(), NULL);
+    }
+
+    return retValue;
+}
+
+TS3Channels::Parsed TS3Channels::failedParse(uint64 channelID, const string& error, function<void(const string&)> done)
+{
+    Parsed retValue;
+
+    stringstream ssCommentary;
+    ssCommentary << "ChannelID: " << channelID << " | Failed to parse: " << error;
+
+    retValue.commentary = ssCommentary.str();
+    retValue.failed = true;
+    retValue.done = done;
+
+    return retValue;
+}
+
+// Puts a batch of parsed channels into the index, in the order they were queued, and publishes them together.
+void TS3Channels::commitParsed(vector<Parsed>& batch)
+{
+    {
+        lock_guard<mutex> lock(mWriteLock);
+
+        for (const Parsed& parsed : batch)
+        {
+            if (parsed.failed) mStatistics.failed++;
+
+            // The last parse queued for a channel is the last committed, as they're committed in order.
+            auto pending = mPending.find(parsed.channelID);
+            if (pending != mPending.end() && --pending->second.queued == 0) mPending.erase(pending);
+
+            if (parsed.tuningRoot != TuningTable::NO_ROOT) mIndex.addTuning(parsed.tuningRoot);
+            if (parsed.channel == NULL) continue;
+
+            mIndex.addOrUpdate(parsed.channel);
+            mStatistics.parsed++;
+        }
+
+        publish();
+    }
+
+    for (const Parsed& parsed : batch)
+    {
+        if (parsed.done) parsed.done(parsed.commentary);
+    }
+}
+
+int TS3Channels::updateChannelDescription(string& strC, uint64 channelID, string cDesc)
+{
+	int retValue = SQLITE_OK;
+
+	mParser->wait();
+
+	try
+	{
+		lock_guard<mutex> lock(mWriteLock);
+
+		const ChannelIndex::Channel* existing = mIndex.getChannel(channelID);
+		if (existing != NULL)
+		{
+			shared_ptr<ChannelIndex::Channel> channel = make_shared<ChannelIndex::Channel>(*existing);
+
+			// The description has been changed without being parsed, so the next full update must not be skipped.
+			if (!mCompact)
+			{
+				shared_ptr<ChannelIndex::Text> text = make_shared<ChannelIndex::Text>();
+				text->topic = existing->getTopic();
+				text->description = cDesc;
+				channel->text = text;
+			}
+			channel->fingerprint = 0;
+
+			mIndex.addOrUpdate(channel);
+			publish();
+		}
+
+		stringstream ssCommentary;
+		ssCommentary << "ChannelID: " << channelID;
+		ssCommentary << " | Desc: " << cDesc;
+
+		strC = ssCommentary.str();
+
+	}
+	catch (exception& e)
+	{
+		e;
+		retValue = UINT16_MAX;
+	}
+
+	return retValue;
+
+}
+
+int TS3Channels::deleteChannel(uint64 channelID)
+{
+    int retValue = SQLITE_OK;
+
+    // A channel still being parsed mustn't turn up again after it's gone.
+    mParser->wait();
+
+    try
+    {
+        lock_guard<mutex> lock(mWriteLock);
+
+        // Everything below the channel goes with it.
+        mIndex.remove(channelID);
+        publish();
+    }
+    catch (exception& e)
+    {
+        e;
+        retValue = UINT16_MAX;
+    }
+
+    return retValue;
+
+}
+
+// Starts building the next generation of the channels from the given server. The last generation carries on
+// serving lookups, unless it came from a different server. A reparse also reloads the airport data and
+// parses every channel again, even if it hasn't changed.
+void TS3Channels::beginRebuild(const string& source, bool reparse)
+{
+    // Anything still being parsed belongs to the last load.
+    mParser->wait();
+
+    lock_guard<mutex> lock(mWriteLock);
+
+    if (source != mSource)
+    {
+        mReady = false;
+        mSource = source;
+    }
+
+    if (reparse)
+    {
+        atomic_store(&icaoData, make_shared<ICAOData>());
+    }
+
+    mRebuilding = true;
+    mReparse = reparse;
+    mRebuildSeen.clear();
+}
+
+// Changes made between these are published together, once the batch is complete.
+void TS3Channels::beginBatch(void)
+{
+    lock_guard<mutex> lock(mWriteLock);
+
+    mBatching = true;
+}
+
+void TS3Channels::endBatch(void)
+{
+    // Anything still being parsed belongs to what's being finished.
+    mParser->wait();
+
+    lock_guard<mutex> lock(mWriteLock);
+
+    if (!mBatching) return;
+
+    mBatching = false;
+    publish();
+}
+
+// True if what TS3 has for a channel without its description still matches what we have. During a rebuild
+// the channel is kept without being fetched again. A description changed while we weren't connected
+// isn't noticed, but it will be the next time the channel is edited.
+bool TS3Channels::isUnchanged(uint64 channelID, string cName, string cTopic, uint64 parentChannel, uint64 order)
+{
+    lock_guard<mutex> lock(mWriteLock);
+
+    // A channel waiting to be parsed is changing, so the index can't vouch for it.
+    if (mPending.find(channelID) != mPending.end()) return false;
+
+    const ChannelIndex::Channel* existing = mIndex.getChannel(channelID);
+    if (existing == NULL || existing->fingerprint == 0 || existing->header != fingerprint(cName, cTopic, "", parentChannel, order))
+        return false;
+
+    if (mRebuilding) mRebuildSeen.insert(channelID);
+    mStatistics.cached++;
+
+    return true;
+}
+
+// Removes whatever wasn't reloaded, then swaps the new generation in for readers.
+void TS3Channels::commitRebuild(void)
+{
+    // Anything still being parsed belongs to what's being finished.
+    mParser->wait();
+
+    lock_guard<mutex> lock(mWriteLock);
+
+    if (!mRebuilding) return;
+
+    vector<uint64> gone;
+    for (const auto& channel : mIndex.getChannels())
+    {
+        if (channel.first != CHANNEL_ROOT && mRebuildSeen.find(channel.first) == mRebuildSeen.end())
+            gone.push_back(channel.first);
+    }
+
+    for (uint64 channelID : gone)
+    {
+        mIndex.remove(channelID);
+    }
+
+    mRebuilding = false;
+    mReparse = false;
+    mRebuildSeen.clear();
+    mGeneration++;
+
+    publish();
+    mReady = true;
+}
+
+bool TS3Channels::channelIsUnderRoot(uint64 current, uint64 root)
+{
+	Snapshot snapshot(mSnapshots);
+
+	return snapshot->isUnderRoot(current, root);
+}
+
+
+// The counts are kept by whichever thread is committing, so they're copied under the same lock.
+TS3Channels::Statistics TS3Channels::getStatistics(void)
+{
+	lock_guard<mutex> lock(mWriteLock);
+
+	return mStatistics;
+}
+
+TS3Channels::Statistics::Statistics()
+{
+	parsed = 0;
+	skipped = 0;
+	cached = 0;
+	failed = 0;
+}
+
+TS3Channels::StationInfo::StationInfo()
+{
+	ch = CHANNEL_ID_NOT_FOUND;
+	lat = -999.0;
+	lon = -999.0;
+	range = 10800.0;
+	maxRange = 10800.0;
+	in_range = false;
+	id = "";
+}
+
+TS3Channels::StationInfo::StationInfo(uint64 channelID)
+{
+	ch = channelID;
+	lat = -999.0;
+	lon = -999.0;
+	range = 10800.0;
+	maxRange = 10800.0;
+	in_range = false;
+	id = "";
+}
+
+TS3Channels::StationInfo::StationInfo(uint64 pCh, double pLat, double pLon, double pRange, double pMaxR, bool pIn_range, string pStation_id)
+{
+	ch = pCh;
+	lat = pLat;
+	lon = pLon;
+	range = pRange;
+	maxRange = pMaxR;
+	in_range = pIn_range;
+	id = pStation_id;
+}
+
+bool TS3Channels::StationInfo::operator!=(const TS3Channels::StationInfo& rhs) const
+{
+	return this->ch != rhs.ch;
+}
+
+bool TS3Channels::StationInfo::operator==(const TS3Channels::StationInfo& rhs) const
+{
+	return this->ch == rhs.ch;
+}
+
+const TS3Channels::LookupKernel TS3Channels::aLookupKernels[3] =
+{
+    &TS3Channels::lookupWith<TS3Channels::RangeIgnored>,
+    &TS3Channels::lookupWith<TS3Channels::RangeOrders>,
+    &TS3Channels::lookupWith<TS3Channels::RangeLimits>
+};
+
+int TS3Channels::kernelFor(bool blConsiderRange, bool blOutOfRangeUntuned)
+{
+    return (!blConsiderRange) ? 0 : (!blOutOfRangeUntuned) ? 1 : 2;
+}
+
+// Picks the kernel for lookupChannelID. Only needs doing when the configuration changes.
+void TS3Channels::setLookupPolicy(bool blConsiderRange, bool blOutOfRangeUntuned)
+{
+    mKernel = kernelFor(blConsiderRange, blOutOfRangeUntuned);
+}
+
+TS3Channels::StationInfo TS3Channels::lookupChannelID(uint32_t frequency, uint64 current, uint64 root, bool bl833Capable, double aLat, double aLon)
+{
+    return (this->*aLookupKernels[mKernel])(frequency, current, root, bl833Capable, aLat, aLon);
+}
+
+TS3Channels::StationInfo TS3Channels::getChannelID(uint32_t frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833Capable, double aLat, double aLon)
+{
+    return (this->*aLookupKernels[kernelFor(blConsiderRange, blOutOfRangeUntuned)])(frequency, current, root, bl833Capable, aLat, aLon);
+}
+
+template<class Range> TS3Channels::StationInfo TS3Channels::lookupWith(uint32_t frequency, uint64 current, uint64 root, bool bl833Capable, double aLat, double aLon)
+{
+    Snapshot snapshot(mSnapshots);
+
+    const TuningTable* tuning = snapshot->getTuning(root);
+    if (tuning != NULL)
+        return findTunedChannel<Range>(*snapshot, *tuning, frequency, current, bl833Capable, aLat, aLon);
+
+    // There's no table for this root yet, so search the whole index until there is.
+    requestTuning(root);
+
+    return findChannel<Range>(*snapshot, frequency, current, root, bl833Capable, aLat, aLon);
+}
+
+// Asks for the tuning table for a root to be built and published, behind any channels still being parsed.
+// Once it's been asked for, lookups wanting the same root don't ask again.
+void TS3Channels::requestTuning(uint64 root)
+{
+    if (mTuningWanted.exchange(root) == root) return;
+
+    auto tune = [root]()
+    {
+        Parsed parsed;
+        parsed.tuningRoot = root;
+        return parsed;
+    };
+
+    mParser->submit(tune, [tune](const string&) { return tune(); });
+}
+
+// The candidates for a frequency, ranked for one current channel other than the root. Channels only move now
+// and again, so the ranking is kept until the channels change or we move, and each lookup just has to work
+// out the ranges.
+struct TuningMemo
+{
+    uint64 version;
+    uint64 root;
+    uint64 current;
+    uint64 key;
+    vector<uint64> ranked;
+
+    TuningMemo() : version(0), root(0), current(0), key(0) {};
+};
+
+static thread_local TuningMemo tuningMemo;
+
+template<class Range> TS3Channels::StationInfo TS3Channels::findTunedChannel(const ChannelIndex& index, const TuningTable& tuning, uint32_t frequency, uint64 current, bool bl833Capable, double aLat, double aLon)
+{
+    // If the current channel is not a child of the root, then flag
+    // us as being outide of the root.
+    const vector<uint64>* currentPath = tuning.getPath(current);
+    if (currentPath == NULL)
+        return TS3Channels::StationInfo(CHANNEL_NOT_CHILD_OF_ROOT);
+
+    uint64 key = ChannelIndex::frequencyKey(frequency, bl833Capable);
+
+    const TuningTable::Partition* partition = tuning.getPartition(key);
+    if (Range::considered && partition != NULL)
+    {
+        // The tracker is only ever a short cut, so don't wait for it if another thread has it.
+        unique_lock<mutex> lock(mTrackerLock, try_to_lock);
+
+        if (Range::untunes && lock.owns_lock())
+        {
+            mTracker.update(index, tuning, aLat, aLon);
+            return findNearestChannel<Range>(index, tuning, *partition, *currentPath, aLat, aLon, &mTracker.getInRange(key), &mTracker.getBoundary(key));
+        }
+
+        return findNearestChannel<Range>(index, tuning, *partition, *currentPath, aLat, aLon);
+    }
+
+    // The table keeps them in the order they rank in from the root, so only another channel needs them ranking.
+    const vector<uint64>& candidates = tuning.getCandidates(key);
+
+    if (current != tuning.getRoot() && (tuningMemo.version != index.getVersion() || tuningMemo.root != tuning.getRoot() || tuningMemo.current != current || tuningMemo.key != key))
+    {
+        vector<tuple<int, int, uint64>> ranked;
+
+        for (uint64 ch : candidates)
+        {
+            int distance;
+            int removed;
+
+            TuningTable::getDistance(*currentPath, *tuning.getPath(ch), distance, removed);
+            ranked.push_back(::make_tuple(distance, removed, ch));
+        }
+
+        sort(ranked.begin(), ranked.end());
+
+        tuningMemo.version = index.getVersion();
+        tuningMemo.root = tuning.getRoot();
+        tuningMemo.current = current;
+        tuningMemo.key = key;
+        tuningMemo.ranked.clear();
+
+        for (const tuple<int, int, uint64>& candidate : ranked)
+            tuningMemo.ranked.push_back(::get<2>(candidate));
+    }
+
+    // Default scenario is that we don't find a result
+    TS3Channels::StationInfo retValue(CHANNEL_ID_NOT_FOUND);
+    double best = 0.0;
+    bool found = false;
+
+    const vector<uint64>& ranked = (current == tuning.getRoot()) ? candidates : tuningMemo.ranked;
+
+    for (uint64 ch : ranked)
+    {
+        const ChannelIndex::Channel* channel = index.getChannel(ch);
+
+        // Channels without a location are always in range.
+        double range = channel->range;
+        if (channel->hasLatLon)
+        {
+            double d = getDistanceBetweenLatLonInNm(channel->lat, channel->lon, aLat, aLon);
+            if (!isnan(d)) range = d;
+        }
+
+        bool inRange = (range <= channel->range);
+        if (Range::untunes && !inRange)
+            continue;
+
+        // They're already nearest in the tree first, so only a closer station can take over from the first found.
+        if (!found || (Range::considered && range < best))
+        {
+            found = true;
+            best = range;
+            retValue = StationInfo(ch, channel->lat, channel->lon, range, channel->range, inRange, channel->station);
+        }
+
+        if (!Range::considered) break;
+    }
+
+    return retValue;
+}
+
+// Closest first, so only channels near the aircraft are looked at, however many share the frequency. Those
+// without a location are all looked at, as they're all at their own maximum range.
+//
+// When out of range channels don't count, and the in range tracker is to hand, only the channels it has
+// in range or near their edge are looked at instead.
+template<class Range> TS3Channels::StationInfo TS3Channels::findNearestChannel(const ChannelIndex& index, const TuningTable& tuning, const TuningTable::Partition& partition, const vector<uint64>& currentPath, double aLat, double aLon, const vector<uint64>* inRange, const vector<uint64>* boundary)
+{
+    // The distances from the tree are only a guide, so go a little further than strictly needed.
+    static const double aSearchSlack = 0.01;
+
+    TS3Channels::StationInfo retValue(CHANNEL_ID_NOT_FOUND);
+    tuple<double, int, int, uint64> best;
+    bool found = false;
+
+    auto consider = [&](uint64 ch)
+    {
+        const ChannelIndex::Channel* channel = index.getChannel(ch);
+        int distance;
+        int removed;
+
+        double range = channel->range;
+        if (channel->hasLatLon)
+        {
+            double d = getDistanceBetweenLatLonInNm(channel->lat, channel->lon, aLat, aLon);
+            if (!isnan(d)) range = d;
+        }
+
+        bool inRange = (range <= channel->range);
+        if (Range::untunes && !inRange)
+            return;
+
+        TuningTable::getDistance(currentPath, *tuning.getPath(ch), distance, removed);
+
+        tuple<double, int, int, uint64> rank = ::make_tuple(range, distance, removed, ch);
+        if (!found || rank < best)
+        {
+            found = true;
+            best = rank;
+            retValue = StationInfo(ch, channel->lat, channel->lon, range, channel->range, inRange, channel->station);
+        }
+    };
+
+    for (uint64 ch : partition.unlocated)
+        consider(ch);
+
+    if (inRange != NULL && boundary != NULL)
+    {
+        for (uint64 ch : *inRange)
+            consider(ch);
+
+        for (uint64 ch : *boundary)
+            consider(ch);
+
+        return retValue;
+    }
+
+    GeoIndex::Search search(partition.located, aLat, aLon);
+    uint64 ch;
+    double nm;
+
+    while (search.next(ch, nm))
+    {
+        if (found && nm > ::get<0>(best) + aSearchSlack)
+            break;
+
+        consider(ch);
+    }
+
+    return retValue;
+}
+
+template<class Range> TS3Channels::StationInfo TS3Channels::findChannel(const ChannelIndex& index, uint32_t frequency, uint64 current, uint64 root, bool bl833Capable, double aLat, double aLon)
+{
+    // If the current channel is not a child of the root, then flag
+    // us as being outide of the root.
+    if (!index.isUnderRoot(current, root))
+        return TS3Channels::StationInfo(CHANNEL_NOT_CHILD_OF_ROOT);
+
+    // Default scenario is that we don't find a result
+    TS3Channels::StationInfo retValue(CHANNEL_ID_NOT_FOUND);
+    tuple<double, int, int, uint64> best;
+    bool found = false;
+
+    for (uint64 ch : index.getChannelsOnFrequency(frequency, bl833Capable))
+    {
+        const ChannelIndex::Channel* channel = index.getChannel(ch);
+        int distance;
+        int removed;
+
+        // Only stations under the root count, and their distance from us is through the closest common parent.
+        if (channel == NULL || !index.isUnderRoot(ch, root) || !index.getDistance(current, ch, distance, removed))
+            continue;
+
+        // Channels without a location are always in range.
+        double range = channel->range;
+        if (channel->hasLatLon)
+        {
+            double d = getDistanceBetweenLatLonInNm(channel->lat, channel->lon, aLat, aLon);
+            if (!isnan(d)) range = d;
+        }
+
+        bool inRange = (range <= channel->range);
+        if (Range::untunes && !inRange)
+            continue;
+
+        // Closest first if we're considering range, then nearest in the tree.
+        tuple<double, int, int, uint64> rank = ::make_tuple(Range::considered ? range : 0.0, distance, removed, ch);
+        if (!found || rank < best)
+        {
+            found = true;
+            best = rank;
+            retValue = StationInfo(ch, channel->lat, channel->lon, range, channel->range, inRange, channel->station);
+        }
+    }
+
+    return retValue;
+
+}
+
+// Returns the ID of the channel corresponding to a frequency provided as a double.
+TS3Channels::StationInfo TS3Channels::getChannelID(double frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833capable, double aLat, double aLon)
+{
+    // Need to get the rounding right
+    // Try 128.300 to see why this is needed!
+    return getChannelID(uint32_t(0.1 * round(1000 * frequency)), current, root, blConsiderRange, blOutOfRangeUntuned, bl833capable, aLat, aLon);
+}
+
+TS3Channels::Explanation::Explanation()
+{
+	tuned = false;
+	fetchNs = 0;
+	rootNs = 0;
+	rangeNs = 0;
+	orderNs = 0;
+	lookupNs = 0;
+}
+
+// Goes through every candidate for a frequency the long way, a stage at a time, recording what each one
+// came to and how long each stage took. The lookup itself is then timed on its own, and its answer is the result.
+// The SQL lookup is run last for comparison.
+//
+// Candidates not under the root have no rank. Neither do those out of range, if out of range channels are untuned.
+TS3Channels::Explanation TS3Channels::explainChannelID(uint32_t frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833Capable, double aLat, double aLon)
+{
+    typedef chrono::steady_clock Clock;
+
+    Explanation retValue;
+
+    {
+        Snapshot snapshot(mSnapshots);
+        const ChannelIndex& index = *snapshot;
+        const TuningTable* tuning = index.getTuning(root);
+
+        retValue.tuned = (tuning != NULL);
+
+        Clock::time_point start = Clock::now();
+
+        vector<uint64> channels = index.getChannelsOnFrequency(frequency, bl833Capable);
+
+        Clock::time_point fetched = Clock::now();
+
+        const vector<uint64>* currentPath = retValue.tuned ? tuning->getPath(current) : NULL;
+        bool currentUnderRoot = retValue.tuned ? (currentPath != NULL) : index.isUnderRoot(current, root);
+
+        for (uint64 ch : channels)
+        {
+            const ChannelIndex::Channel* channel = index.getChannel(ch);
+            if (channel == NULL)
+                continue;
+
+            Explanation::Candidate candidate;
+            candidate.ch = ch;
+            candidate.distance = -1;
+            candidate.removed = -1;
+            candidate.range = channel->range;
+            candidate.maxRange = channel->range;
+            candidate.in_range = false;
+            candidate.rank = 0;
+            candidate.id = channel->station;
+
+            if (retValue.tuned)
+            {
+                const vector<uint64>* path = tuning->getPath(ch);
+                candidate.under_root = (currentPath != NULL && path != NULL);
+                if (candidate.under_root)
+                    TuningTable::getDistance(*currentPath, *path, candidate.distance, candidate.removed);
+            }
+            else
+            {
+                candidate.under_root = currentUnderRoot && index.isUnderRoot(ch, root) && index.getDistance(current, ch, candidate.distance, candidate.removed);
+            }
+
+            retValue.candidates.push_back(candidate);
+        }
+
+        Clock::time_point filtered = Clock::now();
+
+        for (Explanation::Candidate& candidate : retValue.candidates)
+        {
+            const ChannelIndex::Channel* channel = index.getChannel(candidate.ch);
+
+            // Channels without a location are always in range.
+            if (channel->hasLatLon)
+            {
+                double d = getDistanceBetweenLatLonInNm(channel->lat, channel->lon, aLat, aLon);
+                if (!isnan(d)) candidate.range = d;
+            }
+
+            candidate.in_range = (candidate.range <= candidate.maxRange);
+        }
+
+        Clock::time_point ranged = Clock::now();
+
+        // Ranked the same way as the lookup - closest first if we're considering range, then nearest in the tree.
+        auto ranks = [&](const Explanation::Candidate& c)
+        {
+            return c.under_root && !(blConsiderRange && blOutOfRangeUntuned && !c.in_range);
+        };
+
+        auto key = [&](const Explanation::Candidate& c)
+        {
+            return ::make_tuple(!ranks(c), blConsiderRange ? c.range : 0.0, c.distance, c.removed, c.ch);
+        };
+
+        sort(retValue.candidates.begin(), retValue.candidates.end(), [&](const Explanation::Candidate& a, const Explanation::Candidate& b)
+        {
+            return key(a) < key(b);
+        });
+
+        int rank = 0;
+        for (Explanation::Candidate& candidate : retValue.candidates)
+        {
+            if (ranks(candidate)) candidate.rank = ++rank;
+        }
+
+        Clock::time_point ordered = Clock::now();
+
+        retValue.fetchNs = chrono::duration_cast<chrono::nanoseconds>(fetched - start).count();
+        retValue.rootNs = chrono::duration_cast<chrono::nanoseconds>(filtered - fetched).count();
+        retValue.rangeNs = chrono::duration_cast<chrono::nanoseconds>(ranged - filtered).count();
+        retValue.orderNs = chrono::duration_cast<chrono::nanoseconds>(ordered - ranged).count();
+    }
+
+    Clock::time_point start = Clock::now();
+
+    retValue.result = getChannelID(frequency, current, root, blConsiderRange, blOutOfRangeUntuned, bl833Capable, aLat, aLon);
+
+    retValue.lookupNs = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+
+    // Check the answer against the SQL. Debug builds keep the database in a file, so the channels are left
+    // in it to look into it further.
+    retValue.query = getChannelIDFromSql(frequency, current, root, blConsiderRange, blOutOfRangeUntuned, bl833Capable, aLat, aLon);
+
+#if defined(_DEBUG)
+    materialise();
+#endif
+
+    return retValue;
+}
+
+// The lookup as it used to be done, in SQL, against the channel tables. It's far too slow for real use, but it
+// gives a second opinion when the native lookup needs checking.
+const string TS3Channels::aGetChannelFromFreqCurrPrnt = \
+"with stations as( " \
+"select down.child as channel, up.depth + down.depth as distance, down.depth as removed from " \
+"(select * from closure where child = :current and parent in(select child from closure where parent = :root)) as up, " \
+"(select * from closure as c inner join channelFrequency as cf on c.child = cf.channel and frequency = :frequency and freq833 = :freq833) as down " \
+"where " \
+"up.parent = down.parent " \
+"order by up.depth + down.depth, down.depth desc " \
+"), " \
+"ranges as( " \
+"select s.channel, s.distance, s.removed, c.range as max_range, c.latitude, c.longitude, c.station, ifnull(range(c.latitude, c.longitude, :lat, :lon), c.range) as range " \
+"from stations as s " \
+"left join channels as c " \
+"on s.channel = c.channelId " \
+") " \
+"select r.channel, r.distance, r.removed, r.latitude, r.longitude, r.range, r.max_range, (r.range <= r.max_range) as in_range, r.station " \
+"from ranges r" \
+"";
+
+TS3Channels::StationInfo TS3Channels::getChannelIDFromSql(uint32_t frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833Capable, double aLat, double aLon)
+{
+	TS3Channels::StationInfo retValue(CHANNEL_ID_NOT_FOUND);
+
+    try
+    {
+        string strQuery = aGetChannelFromFreqCurrPrnt +
+            string ((blConsiderRange && blOutOfRangeUntuned) ? " where in_range = 1" : "") +
+            " order by " +
+            string ((blConsiderRange) ? "range, " : "") +
+            "distance, removed, channel;";
+
+        SQLite::Statement aStmt(mChanDb, strQuery);
+
+        aStmt.bind(":frequency", frequency);
+		aStmt.bind(":freq833", bl833Capable);
+        aStmt.bind(":current", sqlite3_int64(current));
+        aStmt.bind(":root", sqlite3_int64(root));
+        aStmt.bind(":lat", aLat);
+        aStmt.bind(":lon", aLon);
+
+        if (aStmt.executeStep())
+        {
+			retValue = StationInfo(
+				aStmt.getColumn(0).getInt64(),
+				aStmt.getColumn(3).getDouble(),
+				aStmt.getColumn(4).getDouble(),
+				aStmt.getColumn(5).getDouble(),
+				aStmt.getColumn(6).getDouble(),
+				aStmt.getColumn(7).getInt() != 0,
+				aStmt.getColumn(8).getString()
+				);
+        }
+        else if (!channelIsUnderRoot(current, root))
+        {
+			retValue = TS3Channels::StationInfo(CHANNEL_NOT_CHILD_OF_ROOT);
+        }
+    }
+    catch (SQLite::Exception&)
+    {
+        retValue = TS3Channels::StationInfo(CHANNEL_ID_NOT_FOUND);
+    }
+
+    return retValue;
+}
+
+
+TS3Channels::ChannelInfo::ChannelInfo(uint64 ch, int d, string str)
+{
+    channelID = ch;
+    depth = d;
+    name = str;
+}
+
+
+// Produces the depth first list of channels under (and including) the root, with siblings in TS3 order.
+vector<TS3Channels::ChannelInfo> TS3Channels::getChannelList(uint64 root)
+{
+    vector<TS3Channels::ChannelInfo> retValue;
+    Snapshot snapshot(mSnapshots);
+
+    // Each channel's order is the ID of its previous sibling, so index who follows whom.
+    unordered_map<uint64, vector<uint64>> followers;
+    for (const auto& node : snapshot->getChannels())
+    {
+        if (node.first != CHANNEL_ROOT)
+            followers[node.second->order].push_back(node.first);
+    }
+
+    // Walk the sibling chains breadth first from the root channel. This visits each chain in order, so
+    // appending to each parent as we go leaves every parent's children in TS3 order. Channels which
+    // can't be reached through a chain are left out, as TS3 doesn't display them either.
+    unordered_map<uint64, vector<uint64>> children;
+    vector<uint64> chain = { CHANNEL_ROOT };
+    unordered_set<uint64> reached = { CHANNEL_ROOT };
+
+    for (size_t i = 0; i < chain.size(); i++)
+    {
+        auto next = followers.find(chain[i]);
+        if (next == followers.end())
+            continue;
+
+        for (uint64 ch : next->second)
+        {
+            chain.push_back(ch);
+            reached.insert(ch);
+            children[snapshot->getChannel(ch)->parent].push_back(ch);
+        }
+
+        // Each channel can only be followed once.
+        followers.erase(next);
+    }
+
+    if (reached.find(root) == reached.end())
+        return retValue;
+
+    // Then a single depth first walk, pushing children in reverse so they come off the stack in order.
+    vector<pair<uint64, int>> stack = { make_pair(root, 0) };
+    unordered_set<uint64> visited;
+
+    while (!stack.empty())
+    {
+        uint64 ch = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if (!visited.insert(ch).second)
+            continue;
+
+        retValue.push_back(ChannelInfo(ch, depth, snapshot->getChannel(ch)->name));
+
+        auto kids = children.find(ch);
+        if (kids != children.end())
+        {
+            for (auto kid = kids->second.rbegin(); kid != kids->second.rend(); ++kid)
+            {
+                if (*kid != CHANNEL_ROOT)
+                    stack.push_back(make_pair(*kid, depth + 1));
+            }
+        }
+    }
+
+    return retValue;
+}
+
+
+
+const string TS3Channels::aGetChannelList = \
+"with recursive sort(channelId, parentId, indx, ordering, name) as " \
+"( " \
+"    select channelId, parent, 0, ordering, name from channels where channelId = 0 " \
+"    union " \
+"    select ch.channelId, ch.parent, sort.indx + 1, ch.ordering, ch.name " \
+"    from channels ch " \
+"    inner join sort on ch.ordering = sort.channelId " \
+"    where ch.channelId <> 0 " \
+"    limit 1000000 " \
+"), " \
+"tree(channelId, depth, path, name) as " \
+"( " \
+"    select channelId, 0, printf(\"%08p\", indx), name from sort where channelId = :root " \
+"    union " \
+"    select ch.channelId, tree.depth + 1, tree.path || printf(\" %08p\", ch.indx), ch.name " \
+"    from " \
+"    sort ch " \
+"    inner join tree on ch.parentId = tree.channelId " \
+"    where ch.channelId <> 0 " \
+"    limit 1000000 " \
+") " \
+"select channelId, depth, name from tree order by path; " \
+"";
+
+vector<TS3Channels::ChannelInfo> TS3Channels::getChannelListFromSql(uint64 root)
+{
+    vector<TS3Channels::ChannelInfo> retValue;
+
+    try
+    {
+        SQLite::Statement aStmt(mChanDb, aGetChannelList);
+
+        aStmt.bind(":root", sqlite3_int64(root));
+
+        while (aStmt.executeStep())
+        {
+            retValue.push_back(ChannelInfo(aStmt.getColumn(0).getInt64(), aStmt.getColumn(1).getInt(), aStmt.getColumn(2).getText()));
+        }
+    }
+    catch (SQLite::Exception&)
+    {
+        retValue.clear();
+    }
+
+    return retValue;
+}
+
+void TS3Channels::distanceFunc(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    // check that we have four arguments (lat1, lon1, lat2, lon2)
+
+    // check that all four arguments are non-null
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL || sqlite3_value_type(argv[1]) == SQLITE_NULL || sqlite3_value_type(argv[2]) == SQLITE_NULL || sqlite3_value_type(argv[3]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    // get the four argument values
+    double lat1 = sqlite3_value_double(argv[0]);
+    double lon1 = sqlite3_value_double(argv[1]);
+    double lat2 = sqlite3_value_double(argv[2]);
+    double lon2 = sqlite3_value_double(argv[3]);
+
+	double distance = getDistanceBetweenLatLonInNm(lat1, lon1, lat2, lon2);
+
+	sqlite3_result_double(context, distance);
+
+}
@@ -4,53 +4,104 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
 
-#include <SQLiteCpp\Database.h>
+#include <SQLiteCpp/Database.h>
 #include <sqlite3.h>
 
 #include "teamspeak/public_definitions.h"
 
 #include "ICAOData.h"
+#include "ChannelIndex.h"
+#include "SnapshotPublisher.h"
+#include "StringArena.h"
+#include "InRangeTracker.h"
+#include "ParsePool.h"
+#include "ChannelTables.h"
 
 using namespace ::std;
 
-extern ICAOData* icaoData;
+extern shared_ptr<ICAOData> icaoData;
 
 class TS3Channels
 {
 private:
-	static const string aAddInsertChannelFrequency;
-    static const string aAddInsertChannel;
-    static const string aAddInsertClosure1;
-    static const string aAddInsertClosure2;
-	static const string aUpdateChannelDescription;
-	static const string TS3Channels::aDeleteChannelFrequencies;
-	static const string aDeleteChannels;
-    static const string aDeleteClosure;
+    static const string aCreateChannelTables;
+    static const string aMaterialiseChannels;
     static const string aGetChannelFromFreqCurrPrnt;
-    static const string aChannelIsParentOfChild;
-    static const string aInitChannelList;
     static const string aGetChannelList;
 
     // Ordering of these two is important... it defines what order they're initialized in by the constructor.
     string mChanDbFileName;
     SQLite::Database mChanDb;
 
+    // Changes to the channels come from the TS3 thread, lookups from the sim and UI threads. Writers take
+    // the lock and change the master index, then publish a copy of it. Readers only ever see a published
+    // copy, so they never wait for a writer or see half of a change.
+    mutex mWriteLock;
+    ChannelIndex mIndex;
+    SnapshotPublisher<ChannelIndex> mSnapshots;
+
+    typedef SnapshotPublisher<ChannelIndex>::ReadGuard Snapshot;
+
+    // The root a lookup last wanted a tuning table for, until one's been published. Lookups never build a
+    // table themselves - they ask for it to be built on the parse pool, and do without until it's there.
+    atomic<uint64> mTuningWanted;
+    void requestTuning(uint64 root);
+
+    // Channels queued to be parsed and not yet in the index, with the fingerprint of the last text queued for
+    // each. An update is only unchanged if it matches that, as what's in the index is about to be replaced.
+    struct Pending
+    {
+        uint64 fingerprint;
+        uint64 queued;
+    };
+    unordered_map<uint64, Pending> mPending;
+
+    // A full reload builds the next generation in the master index without publishing it, so lookups carry
+    // on using the last generation until it's complete. Channels not seen again by then have gone.
+    bool mRebuilding;
+    bool mBatching;
+    bool mReparse;
+    unordered_set<uint64> mRebuildSeen;
+    uint64 mGeneration;
+
+    // The server the published generation came from, and whether it can be used for lookups.
+    string mSource;
+    atomic<bool> mReady;
+
+    // Compact storage keeps only what's parsed from a channel, and gets the raw text back from TS3 when asked.
+    bool mCompact;
+    function<bool(uint64, string&, string&)> mTextSource;
 
     string determineChanDbFileName(void);
+    string determineCacheFileName(const string& source);
 
     int initDatabase(void);
+    int initChannelTables(void);
+    void publish(void);
+
+    // Copies the published channels into the database file, so they can be looked at with something else.
+    // Only done when asked to explain a lookup, as it copies every channel.
+    void materialise(void);
 
 	vector<tuple<uint32_t, bool>> getFrequenciesFromString(string);
 	vector<tuple<uint32_t, bool>> getFrequenciesFromStrings(string, string, string);
 	vector<tuple<uint32_t, bool>> getFrequenciesFromStrings(const vector<string>&);
-	string TS3Channels::getAirportIdentFromString(string);
-    string TS3Channels::getAirportIdentFromStrings(string, string, string);
-    string TS3Channels::getAirportIdentFromStrings(const vector<string>&);
-    tuple<double, double> TS3Channels::getLatLonFromString(string);
-    tuple<double, double> TS3Channels::getLatLonFromStrings(string, string, string);
-    tuple<double, double> TS3Channels::getLatLonFromStrings(const vector<string>&);
-	string TS3Channels::concatFreqs(const vector<tuple<uint32_t, bool>>& freqs);
+	string getAirportIdentFromString(string);
+    string getAirportIdentFromStrings(string, string, string);
+    string getAirportIdentFromStrings(const vector<string>&);
+    tuple<double, double> getLatLonFromString(string);
+    tuple<double, double> getLatLonFromStrings(string, string, string);
+    tuple<double, double> getLatLonFromStrings(const vector<string>&);
+	string concatFreqs(const vector<tuple<uint32_t, bool>>& freqs);
+	static uint64 fingerprint(const string&, const string&, const string&, uint64, uint64);
 
 public:
     struct ChannelInfo
@@ -81,7 +132,55 @@ public:
 		bool operator!=(const StationInfo&) const;
 	};
 
-    TS3Channels();
+	// Everything a lookup looked at and why, with how long each stage took, for when a move needs explaining.
+	struct Explanation
+	{
+		struct Candidate
+		{
+			uint64 ch;
+			int distance;
+			int removed;
+			double range;
+			double maxRange;
+			bool under_root;
+			bool in_range;
+			int rank;
+			string id;
+		};
+
+		StationInfo result;
+		bool tuned;
+
+		// What the original SQL lookup makes of it, as a second opinion.
+		StationInfo query;
+		vector<Candidate> candidates;
+
+		// Nanoseconds taken to fetch the candidates, filter them by root, work out their ranges and order them,
+		// and for the lookup itself.
+		int64_t fetchNs;
+		int64_t rootNs;
+		int64_t rangeNs;
+		int64_t orderNs;
+		int64_t lookupNs;
+
+	public:
+		Explanation();
+	};
+
+	struct Statistics
+	{
+		uint64 parsed;
+		uint64 skipped;
+		uint64 cached;
+		uint64 failed;
+
+	public:
+		Statistics();
+	};
+
+    typedef function<bool(uint64, string&, string&)> TextSource;
+
+    TS3Channels(bool compact = false);
     ~TS3Channels();
 
     static const uint64 CHANNEL_ROOT = 0;
@@ -89,15 +188,89 @@ public:
     static const uint64 CHANNEL_ID_NOT_FOUND = UINT64_MAX;
 
     int deleteChannel(uint64);
-    void deleteAllChannels(void);
+    void beginRebuild(const string& source, bool reparse = false);
+    void commitRebuild(void);
+    void beginBatch(void);
+    void endBatch(void);
+    bool isReady(void) { return mReady; };
+    uint64 getGeneration(void) { return mGeneration; };
+    bool isUnchanged(uint64, string, string, uint64 parentChannel, uint64 order);
+    bool isCompact(void) { return mCompact; };
+    void setTextSource(TextSource);
+    bool getChannelText(uint64, string& topic, string& description);
+
+    // Warm start - the last channels seen on a server are kept in a file, ready for next time.
+    bool loadCache(const string& source);
+    bool saveCache(void);
     uint16_t addOrUpdateChannel(string& str, string, string, string, uint64, uint64 parentChannel = 0, uint64 order = 0);
+    void queueChannel(string, string, string, uint64, uint64 parentChannel, uint64 order, function<void(const string&)> done);
 	int updateChannelDescription(string& str, uint64, string);
 	TS3Channels::StationInfo getChannelID(uint32_t frequency, uint64 current = 0, uint64 root = 0, bool blConsiderRange = false, bool blOutOfRangeUntuned = false, bool bl833capable = false, double lat = -999.9, double lon = -999.0);
+	TS3Channels::StationInfo lookupChannelID(uint32_t frequency, uint64 current, uint64 root, bool bl833capable, double lat, double lon);
+	void setLookupPolicy(bool blConsiderRange, bool blOutOfRangeUntuned);
 	TS3Channels::StationInfo getChannelID(double frequency, uint64 current = 0, uint64 root = 0, bool blConsiderRange = false, bool blOutOfRangeUntuned = false, bool bl833capable = false, double lat = -999.9, double lon = -999.0);
-	bool TS3Channels::channelIsUnderRoot(uint64 current, uint64 root);
+	TS3Channels::Explanation explainChannelID(uint32_t frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833Capable, double lat, double lon);
+	TS3Channels::StationInfo getChannelIDFromSql(uint32_t frequency, uint64 current, uint64 root, bool blConsiderRange, bool blOutOfRangeUntuned, bool bl833Capable, double lat, double lon);
+	bool channelIsUnderRoot(uint64 current, uint64 root);
 
     vector<ChannelInfo> getChannelList(uint64 root = 0);
 
-    static void TS3Channels::distanceFunc(sqlite3_context *context, int argc, sqlite3_value **argv);
-	static double TS3Channels::getDistanceBetweenLatLonInNm(double lat1, double lon1, double lat2, double lon2);
+    // The same list from the recursive query it used to come from, run over the channel tables, for checking
+    // getChannelList against.
+    vector<ChannelInfo> getChannelListFromSql(uint64 root = 0);
+
+	Statistics getStatistics(void);
+
+    static void distanceFunc(sqlite3_context *context, int argc, sqlite3_value **argv);
+
+private:
+	// Counts of channel updates which were parsed, which were skipped because nothing had changed, channels
+	// which were taken from the cache without being fetched at all, and updates which couldn't be parsed.
+	Statistics mStatistics;
+
+	// How range is used to choose between the channels on a frequency. Each lookup kernel is built for one of
+	// these, so it isn't decided again for every channel on every lookup. Out of range channels can only be
+	// untuned when range is considered, so there are three rather than four.
+	struct RangeIgnored { static const bool considered = false; static const bool untunes = false; };
+	struct RangeOrders { static const bool considered = true; static const bool untunes = false; };
+	struct RangeLimits { static const bool considered = true; static const bool untunes = true; };
+
+	typedef StationInfo (TS3Channels::*LookupKernel)(uint32_t, uint64, uint64, bool, double, double);
+	static const LookupKernel aLookupKernels[3];
+	static int kernelFor(bool blConsiderRange, bool blOutOfRangeUntuned);
+
+	// The kernel chosen for the configuration, used by lookupChannelID.
+	atomic<int> mKernel;
+
+	template<class Range> StationInfo lookupWith(uint32_t, uint64, uint64, bool, double, double);
+
+	// Lookups use the tuning table when it's for the right root, and search the whole index when it isn't.
+	template<class Range> StationInfo findChannel(const ChannelIndex&, uint32_t, uint64, uint64, bool, double, double);
+	template<class Range> StationInfo findTunedChannel(const ChannelIndex&, const TuningTable&, uint32_t, uint64, bool, double, double);
+	template<class Range> StationInfo findNearestChannel(const ChannelIndex&, const TuningTable&, const TuningTable::Partition&, const vector<uint64>&, double, double, const vector<uint64>* inRange = NULL, const vector<uint64>* boundary = NULL);
+
+	// Which channels have the aircraft in range, kept up to date as it moves.
+	mutex mTrackerLock;
+	InRangeTracker mTracker;
+
+	// A channel once parsed, waiting to go into the index. One that failed has no channel, and says why in
+	// the commentary. One with a tuning root has no channel either, and builds the table for the root.
+	struct Parsed
+	{
+		shared_ptr<const ChannelIndex::Channel> channel;
+		string commentary;
+		uint64 channelID;
+		bool failed;
+		uint64 tuningRoot;
+		function<void(const string&)> done;
+
+		Parsed() : channelID(CHANNEL_ID_NOT_FOUND), failed(false), tuningRoot(TuningTable::NO_ROOT) {};
+	};
+
+	Parsed parseChannel(const string&, const string&, const string&, uint64, uint64, uint64, uint64);
+	static Parsed failedParse(uint64, const string& error, function<void(const string&)> done);
+	void commitParsed(vector<Parsed>&);
+
+	// Declared last, so that its jobs are finished before anything they use goes away.
+	unique_ptr<ParsePool<Parsed>> mParser;
 };
@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "TuningTable.h"
+
+using namespace std;
+
+TuningTable::TuningTable(uint64 root)
+{
+    mRoot = root;
+}
+
+// The path from the root down to the channel, or NULL if the channel isn't under the root.
+const vector<uint64>* TuningTable::getPath(uint64 channel) const
+{
+    const Entry* entry = mEntries.find(channel);
+    return (entry == NULL) ? NULL : &entry->path;
+}
+
+const vector<uint64>& TuningTable::getCandidates(uint64 frequencyKey) const
+{
+    static const vector<uint64> none;
+
+    const vector<uint64>* candidates = mCandidates.find(frequencyKey);
+    return (candidates == NULL) ? none : *candidates;
+}
+
+// NULL if the frequency has changed since the last refresh, or nothing under the root carries it.
+const TuningTable::Partition* TuningTable::getPartition(uint64 frequencyKey) const
+{
+    if (mChanged.find(frequencyKey) != mChanged.end()) return NULL;
+
+    const shared_ptr<const Partition>* partition = mPartitions.find(frequencyKey);
+    return (partition == NULL) ? NULL : partition->get();
+}
+
+void TuningTable::add(uint64 channel, const vector<uint64>& path, const vector<uint64>& frequencyKeys, bool located, double lat, double lon)
+{
+    remove(channel);
+
+    Entry& entry = mEntries[channel];
+    entry.path = path;
+    entry.frequencyKeys = frequencyKeys;
+    entry.located = located;
+    entry.lat = lat;
+    entry.lon = lon;
+
+    for (uint64 key : frequencyKeys)
+    {
+        mChanged.insert(key);
+
+        vector<uint64>& candidates = mCandidates[key];
+        auto position = lower_bound(candidates.begin(), candidates.end(), channel, [this](uint64 a, uint64 b) { return isBefore(a, b); });
+
+        if (position == candidates.end() || *position != channel)
+            candidates.insert(position, channel);
+    }
+}
+
+void TuningTable::remove(uint64 channel)
+{
+    const Entry* entry = mEntries.find(channel);
+    if (entry == NULL) return;
+
+    for (uint64 key : entry->frequencyKeys)
+    {
+        mChanged.insert(key);
+
+        vector<uint64>* candidates = mCandidates.edit(key);
+        if (candidates == NULL) continue;
+
+        auto position = lower_bound(candidates->begin(), candidates->end(), channel, [this](uint64 a, uint64 b) { return isBefore(a, b); });
+        if (position != candidates->end() && *position == channel)
+            candidates->erase(position);
+
+        if (candidates->empty()) mCandidates.erase(key);
+    }
+
+    mEntries.erase(channel);
+}
+
+void TuningTable::clear(uint64 root)
+{
+    mRoot = root;
+    mEntries.clear();
+    mCandidates.clear();
+    mPartitions.clear();
+    mChanged.clear();
+}
+
+void TuningTable::refresh(void)
+{
+    for (uint64 key : mChanged)
+    {
+        const vector<uint64>* candidates = mCandidates.find(key);
+        if (candidates == NULL)
+        {
+            mPartitions.erase(key);
+            continue;
+        }
+
+        vector<GeoIndex::Location> located;
+        vector<uint64> unlocated;
+
+        for (uint64 channel : *candidates)
+        {
+            const Entry& entry = *mEntries.find(channel);
+
+            if (entry.located)
+            {
+                GeoIndex::Location location = { channel, entry.lat, entry.lon };
+                located.push_back(location);
+            }
+            else
+            {
+                unlocated.push_back(channel);
+            }
+        }
+
+        mPartitions[key] = make_shared<const Partition>(located, unlocated);
+    }
+
+    mChanged.clear();
+}
+
+// The order candidates are kept in - nearest the root first, then by channel ID. Both must be in the table.
+bool TuningTable::isBefore(uint64 a, uint64 b) const
+{
+    size_t depthA = mEntries.find(a)->path.size();
+    size_t depthB = mEntries.find(b)->path.size();
+
+    return (depthA != depthB) ? (depthA < depthB) : (a < b);
+}
+
+// Same answer as ChannelIndex::getDistance - the paths part company at the closest common parent.
+void TuningTable::getDistance(const vector<uint64>& from, const vector<uint64>& to, int& distance, int& removed)
+{
+    size_t common = 0;
+    while (common < from.size() && common < to.size() && from[common] == to[common]) common++;
+
+    removed = int(to.size() - common);
+    distance = int(from.size() - common) + removed;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "teamspeak/public_definitions.h"
+
+#include "CowMap.h"
+#include "GeoIndex.h"
+
+using namespace ::std;
+
+// The channels under one root which can be tuned to, kept up to date as the channels change.
+//
+// For every channel under the root it holds the path down from the root, so the distance between two
+// channels comes from comparing their paths rather than walking up the tree. For every frequency it holds
+// the channels under the root which carry it, and the same channels split by location.
+//
+// The channels on a frequency are kept nearest the root first, then in channel ID order. From the root
+// itself that's the order a lookup ranks them in, so it needn't rank them at all.
+class TuningTable
+{
+public:
+    static const uint64 NO_ROOT = UINT64_MAX;
+
+    // Channels with a location in a k-d tree, so that only the closest need be looked at, and the rest apart.
+    struct Partition
+    {
+        GeoIndex located;
+        vector<uint64> unlocated;
+
+        Partition(const vector<GeoIndex::Location>& l, const vector<uint64>& u) : located(l), unlocated(u) {};
+    };
+
+    TuningTable(uint64 root = NO_ROOT);
+
+    uint64 getRoot(void) const { return mRoot; };
+
+    const vector<uint64>* getPath(uint64 channel) const;
+    const vector<uint64>& getCandidates(uint64 frequencyKey) const;
+    typedef CowMap<uint64, vector<uint64>> Candidates;
+
+    const Candidates& getAllCandidates(void) const { return mCandidates; };
+    const Partition* getPartition(uint64 frequencyKey) const;
+
+    void add(uint64 channel, const vector<uint64>& path, const vector<uint64>& frequencyKeys, bool located, double lat, double lon);
+    void remove(uint64 channel);
+    void clear(uint64 root);
+
+    // The partitions of frequencies which have changed are only rebuilt when this is called.
+    void refresh(void);
+
+    static void getDistance(const vector<uint64>& from, const vector<uint64>& to, int& distance, int& removed);
+
+private:
+    bool isBefore(uint64 a, uint64 b) const;
+
+    struct Entry
+    {
+        vector<uint64> path;
+        vector<uint64> frequencyKeys;
+        bool located;
+        double lat;
+        double lon;
+    };
+
+    // Copies of the table share whatever hasn't changed since they were made.
+    uint64 mRoot;
+    CowMap<uint64, Entry> mEntries;
+    Candidates mCandidates;
+
+    // Partitions don't change once built, so they're shared as well.
+    CowMap<uint64, shared_ptr<const Partition>> mPartitions;
+    unordered_set<uint64> mChanged;
+};
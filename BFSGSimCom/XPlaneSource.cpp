@@ -0,0 +1,274 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mstcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "XPlaneSource.h"
+
+using namespace std;
+
+#ifdef _WIN32
+typedef int socklen_t;
+#else
+typedef int SOCKET;
+#endif
+
+static void closeSocket(intptr_t s)
+{
+#ifdef _WIN32
+    ::closesocket(SOCKET(s));
+#else
+    ::close(int(s));
+#endif
+}
+
+// The 8.33 datarefs are in kHz, whatever the spacing. The selection is 6 for com1 and 7 for com2.
+const char* XPlaneSource::aDatarefs[REF_COUNT] =
+{
+    "sim/cockpit2/radios/actuators/com1_frequency_hz_833",
+    "sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833",
+    "sim/cockpit2/radios/actuators/com2_frequency_hz_833",
+    "sim/cockpit2/radios/actuators/com2_standby_frequency_hz_833",
+    "sim/cockpit2/radios/actuators/audio_com_selection",
+    "sim/flightmodel/position/latitude",
+    "sim/flightmodel/position/longitude",
+    "sim/flightmodel/failures/onground_any"
+};
+
+const chrono::milliseconds XPlaneSource::STALE_AFTER(2000);
+
+// An RREF request - the dataref X-Plane's to send, how often, and the index to send it back with.
+static const size_t RREF_PATH = 400;
+static const size_t RREF_REQUEST = 5 + 4 + 4 + RREF_PATH;
+
+XPlaneSource::XPlaneSource(const string& host, int port, int rate) :
+    mHost(host),
+    mPort(port),
+    mRate(rate),
+    mSocket(-1)
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+    memset(mValues, 0, sizeof(mValues));
+    memset(mReceived, 0, sizeof(mReceived));
+}
+
+XPlaneSource::~XPlaneSource()
+{
+    close();
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+// Connected once everything's been heard from, and for as long as it keeps coming.
+bool XPlaneSource::open(void)
+{
+    bool blSubscribed = false;
+
+    if (mSocket == -1)
+    {
+        SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s == SOCKET(-1)) return false;
+
+        // Anything that's waiting is read as it comes, so nothing should ever wait on the socket.
+#ifdef _WIN32
+        u_long nonBlocking = 1;
+        ioctlsocket(s, FIONBIO, &nonBlocking);
+
+        // Windows turns a request sent before X-Plane's there into an error on the socket, which makes it
+        // readable with nothing to read. Those are of no interest, so it's told not to.
+        BOOL connReset = FALSE;
+        DWORD returned = 0;
+        WSAIoctl(s, SIO_UDP_CONNRESET, &connReset, sizeof(connReset), NULL, 0, &returned, NULL, NULL);
+#else
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+        mSocket = intptr_t(s);
+
+        memset(mReceived, 0, sizeof(mReceived));
+        mLastData = chrono::steady_clock::time_point();
+
+        if (!subscribe(mRate))
+        {
+            close();
+            return false;
+        }
+
+        blSubscribed = true;
+    }
+
+    drain();
+
+    if (isLive()) return true;
+
+    // X-Plane may not have been running when we asked, or may have restarted since, so ask again. How
+    // often that is is up to the poller, which backs off while there's no sim.
+    if (!blSubscribed) subscribe(mRate);
+
+    return false;
+}
+
+bool XPlaneSource::read(Snapshot& snapshot)
+{
+    drain();
+
+    if (!isLive()) return false;
+
+    snapshot.com1 = int(mValues[REF_COM1]);
+    snapshot.com1Sby = int(mValues[REF_COM1SBY]);
+    snapshot.com2 = int(mValues[REF_COM2]);
+    snapshot.com2Sby = int(mValues[REF_COM2SBY]);
+
+    int selection = int(mValues[REF_COM_SELECTION]);
+    snapshot.selectedCom = (selection == 6) ? Com1 : (selection == 7) ? Com2 : None;
+
+    snapshot.onGround = (mValues[REF_ON_GROUND] != 0.0f);
+    snapshot.lat = mValues[REF_LATITUDE];
+    snapshot.lon = mValues[REF_LONGITUDE];
+
+    // The datarefs carry the full frequency, so the radios are always taken to be 8.33 capable.
+    snapshot.is833 = true;
+
+    return true;
+}
+
+void XPlaneSource::close(void)
+{
+    if (mSocket == -1) return;
+
+    // Asking for nothing stops X-Plane sending - it'd carry on otherwise.
+    subscribe(0);
+
+    closeSocket(mSocket);
+    mSocket = -1;
+}
+
+bool XPlaneSource::waitForData(chrono::milliseconds timeout)
+{
+    if (mSocket == -1) return SimSource::waitForData(timeout);
+
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(SOCKET(mSocket), &readable);
+
+    timeval tv;
+    tv.tv_sec = long(timeout.count() / 1000);
+    tv.tv_usec = long((timeout.count() % 1000) * 1000);
+
+    if (::select(int(mSocket) + 1, &readable, NULL, NULL, &tv) <= 0) return false;
+
+    // Only values count - an interrupt, or anything else that woke us, is read and dropped here.
+    return drain();
+}
+
+void XPlaneSource::interrupt(void)
+{
+    intptr_t s = mSocket;
+    if (s == -1) return;
+
+    // An empty datagram to wherever we're bound is enough to wake select, and it's ignored when it's read.
+    sockaddr_in self;
+    socklen_t selfLength = sizeof(self);
+    if (::getsockname(SOCKET(s), reinterpret_cast<sockaddr*>(&self), &selfLength) != 0) return;
+
+    self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::sendto(SOCKET(s), "", 0, 0, reinterpret_cast<const sockaddr*>(&self), sizeof(self));
+}
+
+bool XPlaneSource::subscribe(int rate)
+{
+    sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons(uint16_t(mPort));
+    if (inet_pton(AF_INET, mHost.c_str(), &to.sin_addr) != 1) return false;
+
+    bool retValue = true;
+
+    for (int32_t i = 0; i < REF_COUNT; i++)
+    {
+        char request[RREF_REQUEST];
+        int32_t frequency = rate;
+
+        memset(request, 0, sizeof(request));
+        memcpy(request, "RREF", 5);
+        memcpy(request + 5, &frequency, 4);
+        memcpy(request + 9, &i, 4);
+        memcpy(request + 13, aDatarefs[i], (min)(strlen(aDatarefs[i]), RREF_PATH - 1));
+
+        if (::sendto(SOCKET(mSocket), request, int(sizeof(request)), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to)) != int(sizeof(request)))
+            retValue = false;
+    }
+
+    return retValue;
+}
+
+// Reads everything that's arrived since last time, true if any of it was values. Each datagram is "RREF",
+// a byte, and then any number of index and value pairs.
+bool XPlaneSource::drain(void)
+{
+    char datagram[1500];
+    bool retValue = false;
+
+    for (;;)
+    {
+        sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+
+        int length = int(::recvfrom(SOCKET(mSocket), datagram, int(sizeof(datagram)), 0, reinterpret_cast<sockaddr*>(&from), &fromLength));
+        if (length < 0)
+        {
+#ifdef _WIN32
+            // A request that got nowhere, should Windows still report one. There may be more behind it.
+            if (WSAGetLastError() == WSAECONNRESET) continue;
+#endif
+            break;
+        }
+
+        if (length < 5 || memcmp(datagram, "RREF", 4) != 0) continue;
+
+        for (int pos = 5; pos + 8 <= length; pos += 8)
+        {
+            int32_t index;
+            float value;
+
+            memcpy(&index, datagram + pos, 4);
+            memcpy(&value, datagram + pos + 4, 4);
+
+            if (index < 0 || index >= REF_COUNT) continue;
+
+            mValues[index] = value;
+            mReceived[index] = true;
+        }
+
+        mLastData = chrono::steady_clock::now();
+        retValue = true;
+    }
+
+    return retValue;
+}
+
+bool XPlaneSource::isLive(void)
+{
+    for (int i = 0; i < REF_COUNT; i++)
+        if (!mReceived[i]) return false;
+
+    return chrono::steady_clock::now() - mLastData < STALE_AFTER;
+}
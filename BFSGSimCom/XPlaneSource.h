@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "SimSource.h"
+
+using namespace ::std;
+
+// X-Plane, spoken to directly over its UDP interface rather than through XPUIPC.
+//
+// Opening it asks X-Plane to send the datarefs we need (with an RREF request for each), and X-Plane then
+// sends them on its own, at the rate asked for, to the socket the requests came from. Nothing's read until
+// they arrive, so the socket never blocks. The sim is taken to be there for as long as the values keep coming.
+class XPlaneSource : public SimSource
+{
+public:
+    XPlaneSource(const string& host = "127.0.0.1", int port = 49000, int rate = 20);
+    ~XPlaneSource();
+
+    bool open(void);
+    bool read(Snapshot&);
+    void close(void);
+    const char* getName(void) { return "X-Plane"; };
+
+    // True as soon as values have come in. Interrupting sends an empty datagram to ourselves, which wakes
+    // the wait without counting as any.
+    bool canWait(void) { return true; };
+    bool waitForData(chrono::milliseconds timeout);
+    void interrupt(void);
+
+private:
+    enum Dataref
+    {
+        REF_COM1,
+        REF_COM1SBY,
+        REF_COM2,
+        REF_COM2SBY,
+        REF_COM_SELECTION,
+        REF_LATITUDE,
+        REF_LONGITUDE,
+        REF_ON_GROUND,
+        REF_COUNT
+    };
+
+    static const char* aDatarefs[REF_COUNT];
+
+    // How long without hearing from X-Plane before it's taken to have gone.
+    static const chrono::milliseconds STALE_AFTER;
+
+    string mHost;
+    int mPort;
+    int mRate;
+
+    // The socket - a SOCKET on Windows, a descriptor elsewhere - or -1 when there isn't one. It's only
+    // opened and closed by the polling thread, but can be interrupted from any.
+    atomic<intptr_t> mSocket;
+
+    float mValues[REF_COUNT];
+    bool mReceived[REF_COUNT];
+
+    chrono::steady_clock::time_point mLastData;
+
+    bool subscribe(int rate);
+    bool drain(void);
+    bool isLive(void);
+};
@@ -112,10 +112,19 @@ void Config::addChannelList(QTreeWidget* parent, vector<TS3Channels::ChannelInfo
 void Config::populateChannelList(void)
 {
 	vector<TS3Channels::ChannelInfo> channels;
+	shared_ptr<TS3Channels> tch = atomic_load(&chList);
+
+	// Without a server connection there's nothing to show.
+	if (tch == NULL)
+	{
+		treeParentChannel->clear();
+		treeUntunedChannel->clear();
+		return;
+	}
 
 	// Populate the root channel view...
 	// As we do this, the untuned channel view should be automatically populated!
-	channels = chList->getChannelList();
+	channels = tch->getChannelList();
 	addChannelList(treeParentChannel, channels, iRoot);
 	treeParentChannel->resizeColumnToContents(0);
 	treeParentChannel->resizeColumnToContents(1);
@@ -169,7 +178,7 @@ void Config::setInfoDetailed(bool infoDetailed)
 	saveSettings();
 }
 
-Config::Config(TS3Channels& tch)
+Config::Config(shared_ptr<TS3Channels> tch)
 {
     bool blD;
     bool blM;
@@ -180,7 +189,7 @@ Config::Config(TS3Channels& tch)
 	QSettings::setDefaultFormat(QSettings::IniFormat);
 	QSettings settings;
 
-	chList = &tch;
+	chList = tch;
 
     setupUi(this);
 
@@ -216,6 +225,32 @@ Config::Config(TS3Channels& tch)
     blConsiderRange = settings.value("mode/considerRange").toBool();
     cbConsiderRange->setChecked(blConsiderRange);
 
+    // There's no control for this one - "compact" drops the raw channel text once it's parsed.
+    blCompactStorage = (settings.value("channel/storage", "full").toString() == "compact");
+
+    // Nor for how often the simulator is polled, in milliseconds.
+    PollScheduler::Rates defaultRates;
+    pollRates.burst = chrono::milliseconds(settings.value("poll/burst", int(defaultRates.burst.count())).toInt());
+    pollRates.normal = chrono::milliseconds(settings.value("poll/normal", int(defaultRates.normal.count())).toInt());
+    pollRates.cruise = chrono::milliseconds(settings.value("poll/cruise", int(defaultRates.cruise.count())).toInt());
+    pollRates.backoff = chrono::milliseconds(settings.value("poll/backoff", int(defaultRates.backoff.count())).toInt());
+    pollRates.burstFor = chrono::milliseconds(settings.value("poll/burstFor", int(defaultRates.burstFor.count())).toInt());
+    pollRates.cruiseAfter = chrono::milliseconds(settings.value("poll/cruiseAfter", int(defaultRates.cruiseAfter.count())).toInt());
+
+    // Or for flying a scripted route instead of connecting to the simulator.
+    strSimSource = ::string(settings.value("sim/source", "fsuipc").toString().toUtf8().constData());
+    strSimScript = ::string(settings.value("sim/script").toString().toUtf8().constData());
+    dSimTimeScale = settings.value("sim/timeScale", 1.0).toDouble();
+
+    // Or for playing back a recorded one, and where to keep recordings of what the simulator does.
+    strSimReplay = ::string(settings.value("sim/replay").toString().toUtf8().constData());
+    strSimRecord = ::string(settings.value("sim/record").toString().toUtf8().constData());
+
+    // And for talking to X-Plane directly - where it is, and how many times a second it's to send.
+    strXPlaneHost = ::string(settings.value("xplane/host", "127.0.0.1").toString().toUtf8().constData());
+    iXPlanePort = settings.value("xplane/port", 49000).toInt();
+    iXPlaneRate = settings.value("xplane/rate", 20).toInt();
+
     if (!(rbDisabled->isChecked() || rbEasyMode->isChecked() || rbExpertMode->isChecked()))
     {
         rbDisabled->setChecked(true);
@@ -331,15 +366,16 @@ tuple<uint64, string> Config::getSelectedChannelId(QTreeWidget* parent)
 void Config::newRoot()
 {
     vector<TS3Channels::ChannelInfo> channels;
+    shared_ptr<TS3Channels> tch = atomic_load(&chList);
 
     // Get the root channel (which is the selected channel in the real root widget.
 	tuple<uint64, string> chInfo = getSelectedChannelId(treeParentChannel);
     ::tie(iRoot, strRoot) = chInfo;
 
     // If we've selected a new channel
-    if (iRoot != TS3Channels::CHANNEL_ID_NOT_FOUND)
+    if (iRoot != TS3Channels::CHANNEL_ID_NOT_FOUND && tch != NULL)
     {
-        channels = chList->getChannelList(iRoot);
+        channels = tch->getChannelList(iRoot);
         addChannelList(treeUntunedChannel, channels, iUntuned);
         treeUntunedChannel->resizeColumnToContents(0);
         treeUntunedChannel->resizeColumnToContents(1);
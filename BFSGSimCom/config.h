@@ -6,7 +6,9 @@
 #include "ui_config.h"
 
 #include <vector>
+#include <memory>
 #include "TS3Channels.h"
+#include "PollScheduler.h"
 
 using namespace std;
 
@@ -22,7 +24,7 @@ public:
         CONFIG_AUTO
     };
 
-    Config(TS3Channels&);
+    Config(shared_ptr<TS3Channels> = NULL);
     ~Config();
     int exec(void);
 
@@ -32,6 +34,16 @@ public:
     bool getUntuned(void) { return blUntuned; };
     bool getOutOfRangeUntuned(void) { return blOutOfRangeUntuned; };
     bool getConsiderRange(void) { return blConsiderRange; };
+    bool getCompactStorage(void) { return blCompactStorage; };
+    PollScheduler::Rates getPollRates(void) { return pollRates; };
+    string getSimSource(void) { return strSimSource; };
+    string getSimScript(void) { return strSimScript; };
+    double getSimTimeScale(void) { return dSimTimeScale; };
+    string getSimReplay(void) { return strSimReplay; };
+    string getSimRecord(void) { return strSimRecord; };
+    string getXPlaneHost(void) { return strXPlaneHost; };
+    int getXPlanePort(void) { return iXPlanePort; };
+    int getXPlaneRate(void) { return iXPlaneRate; };
     void setUntuned(bool bl);
 	void setInfoDetailed(bool bl);
     uint64 getRootChannel(void) { return (iRoot == 0) ? TS3Channels::CHANNEL_ID_NOT_FOUND : iRoot; };
@@ -39,6 +51,7 @@ public:
 	string getRootChannelName(void) { return strRoot; };
 	string getUntunedChannelName(void) { return strUntuned; };
 	void populateChannelList(void);
+	void setChannelList(shared_ptr<TS3Channels> tch) { atomic_store(&chList, tch); };
 
 protected slots:
     void accept();
@@ -55,6 +68,16 @@ private:
 	bool blInfoDetailed;
     bool blUntuned;
     bool blConsiderRange;
+    bool blCompactStorage;
+    PollScheduler::Rates pollRates;
+    string strSimSource;
+    string strSimScript;
+    double dSimTimeScale;
+    string strSimReplay;
+    string strSimRecord;
+    string strXPlaneHost;
+    int iXPlanePort;
+    int iXPlaneRate;
     bool blOutOfRangeUntuned;
 	bool blRestartInManualMode;
     uint64 iRoot;
@@ -63,7 +86,8 @@ private:
 	string strUntuned;
     //bool initialising = true;
 
-    TS3Channels* chList = NULL;
+    // Set from the TS3 thread as servers come and go, and read on the Qt thread, so only ever swapped whole.
+    shared_ptr<TS3Channels> chList;
     QStringList getChannelTreeViewEntry(TS3Channels::ChannelInfo ch);
     tuple<uint64, string> getSelectedChannelId(QTreeWidget* parent);
     void addChannelList(QTreeWidget* qtree, vector<TS3Channels::ChannelInfo>& channels, uint64 selection);
@@ -52,6 +52,7 @@ extern BOOL FSUIPC_Read(DWORD dwOffset, DWORD dwSize, void *pDest, DWORD *pdwRes
 //extern BOOL FSUIPC_ReadSpecial(DWORD dwOffset, DWORD dwSize, void *pDest, DWORD *pdwResult);
 extern BOOL FSUIPC_Write(DWORD dwOffset, DWORD dwSize, void *pSrce, DWORD *pdwResult);
 extern BOOL FSUIPC_Process(DWORD *pdwResult);
+extern const BYTE *FSUIPC_Reply(DWORD iRead, DWORD *pdwSize); // A read's answer in place, after FSUIPC_Process, with pDest NULL to skip the copy
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,208 @@
+/* IPCPOSIX.C	The POSIX transport for IPCuser - shared memory and named semaphores
+*******************************************************************************
+
+There's no FSUIPC off Windows, so this talks to the stand-in sim in IPCsim.c, which serves the same
+FS6IPC read and write requests from an offset table. That lets the library, and whatever's built on it,
+be run and load tested elsewhere. See IPCposix.h for how the two talk.
+
+Link with -lrt -pthread where the C library needs it.
+
+******************************************************************************/
+
+#include "IPCuser.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "IPCposix.h"
+
+static FS6IPC_POSIX_MAILBOX* m_pMailbox = 0; // the sim's mailbox
+static sem_t*  m_pLock = SEM_FAILED;
+static sem_t*  m_pRequest = SEM_FAILED;
+static sem_t*  m_pReply = SEM_FAILED;
+static char    m_szName[64];                 // name of our shared block
+static BYTE*   m_pView = 0;                  // pointer to our shared block
+static DWORD   m_dwSize = 0;
+
+/******************************************************************************
+			Posix_Close
+******************************************************************************/
+
+static void Posix_Close(void)
+{	if (m_pView)
+	{	munmap(m_pView, m_dwSize);
+		shm_unlink(m_szName);
+		m_pView = 0;
+	}
+
+	if (m_pMailbox)
+	{	munmap(m_pMailbox, sizeof(FS6IPC_POSIX_MAILBOX));
+		m_pMailbox = 0;
+	}
+
+	if (m_pLock != SEM_FAILED)
+	{	sem_close(m_pLock);
+		m_pLock = SEM_FAILED;
+	}
+
+	if (m_pRequest != SEM_FAILED)
+	{	sem_close(m_pRequest);
+		m_pRequest = SEM_FAILED;
+	}
+
+	if (m_pReply != SEM_FAILED)
+	{	sem_close(m_pReply);
+		m_pReply = SEM_FAILED;
+	}
+}
+
+/******************************************************************************
+			Posix_Open
+******************************************************************************/
+
+static BYTE* Posix_Open(DWORD dwSize, BOOL *pfWideFS, DWORD *pdwResult)
+{	static int nTry = 0;
+	void* pView;
+	int fd;
+
+	*pfWideFS = FALSE;
+
+	// Find the sim's mailbox, which is there for as long as it's running
+	fd = shm_open(FS6IPC_POSIX_NAME, O_RDWR, 0);
+	if (fd < 0)
+	{	*pdwResult = FSUIPC_ERR_NOFS;
+		return NULL;
+	}
+
+	pView = mmap(NULL, sizeof(FS6IPC_POSIX_MAILBOX), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pView == MAP_FAILED)
+	{	*pdwResult = FSUIPC_ERR_NOFS;
+		return NULL;
+	}
+
+	m_pMailbox = (FS6IPC_POSIX_MAILBOX*)pView;
+
+	m_pLock = sem_open(FS6IPC_POSIX_LOCK, 0);
+	m_pRequest = sem_open(FS6IPC_POSIX_REQUEST, 0);
+	m_pReply = sem_open(FS6IPC_POSIX_REPLY, 0);
+	if (m_pMailbox->dwMagic != FS6IPC_POSIX_MAGIC || m_pLock == SEM_FAILED || m_pRequest == SEM_FAILED || m_pReply == SEM_FAILED)
+	{	*pdwResult = FSUIPC_ERR_NOFS;
+		Posix_Close();
+		return NULL;
+	}
+
+	// create the name of our shared block
+	nTry++; // Ensures a unique string is used in case user closes and reopens
+	snprintf(m_szName, sizeof(m_szName), FS6IPC_POSIX_NAME ".%X.%X", (unsigned)getpid(), nTry);
+
+	fd = shm_open(m_szName, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+	{	*pdwResult = FSUIPC_ERR_MAP;
+		Posix_Close();
+		return NULL;
+	}
+
+	if (ftruncate(fd, dwSize) != 0)
+	{	*pdwResult = FSUIPC_ERR_MAP;
+		close(fd);
+		shm_unlink(m_szName);
+		Posix_Close();
+		return NULL;
+	}
+
+	pView = mmap(NULL, dwSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pView == MAP_FAILED)
+	{	*pdwResult = FSUIPC_ERR_VIEW;
+		shm_unlink(m_szName);
+		Posix_Close();
+		return NULL;
+	}
+
+	m_pView = (BYTE*)pView;
+	m_dwSize = dwSize;
+
+	*pdwResult = FSUIPC_ERR_OK;
+	return m_pView;
+}
+
+/******************************************************************************
+			Posix_Send
+******************************************************************************/
+
+// Waits on a semaphore until the deadline, carrying on through signals.
+static BOOL Posix_Wait(sem_t* pSem, const struct timespec* pDeadline)
+{	while (sem_timedwait(pSem, pDeadline) != 0)
+	{	if (errno != EINTR)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL Posix_Send(DWORD *pdwResult)
+{	struct timespec deadline;
+	DWORD dwSeq;
+	BOOL fAnswered = FALSE;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += FS6IPC_POSIX_TIMEOUT / 1000;
+	deadline.tv_nsec += (FS6IPC_POSIX_TIMEOUT % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L)
+	{	deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	// Only one request can be in the mailbox at a time
+	if (!Posix_Wait(m_pLock, &deadline))
+	{	*pdwResult = (errno == ETIMEDOUT) ? FSUIPC_ERR_TIMEOUT : FSUIPC_ERR_SENDMSG;
+		return FALSE;
+	}
+
+	// The number's counted in the mailbox, so it's the next one whichever client asked last
+	m_pMailbox->dwSize = m_dwSize;
+	memcpy(m_pMailbox->szName, m_szName, sizeof(m_szName));
+	dwSeq = ++m_pMailbox->dwSeq;
+
+	sem_post(m_pRequest);
+
+	// Anything answered before this one was given up on, so wait for ours
+	while (Posix_Wait(m_pReply, &deadline))
+	{	if (m_pMailbox->dwDone == dwSeq)
+		{	fAnswered = TRUE;
+			break;
+		}
+	}
+
+	if (!fAnswered)
+	{	*pdwResult = (errno == ETIMEDOUT) ? FSUIPC_ERR_TIMEOUT : FSUIPC_ERR_SENDMSG;
+		sem_post(m_pLock);
+		return FALSE;
+	}
+
+	if (m_pMailbox->dwResult != FS6IPC_MESSAGE_SUCCESS)
+	{	*pdwResult = FSUIPC_ERR_DATA; // The sim didn't like something in the data!
+		sem_post(m_pLock);
+		return FALSE;
+	}
+
+	sem_post(m_pLock);
+
+	*pdwResult = FSUIPC_ERR_OK;
+	return TRUE;
+}
+
+const IPC_TRANSPORT IPC_PosixTransport = { "POSIX", Posix_Open, Posix_Send, Posix_Close };
+
+#endif
+
+/******************************************************************************
+ End of IPCposix module
+******************************************************************************/
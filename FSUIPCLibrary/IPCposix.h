@@ -0,0 +1,32 @@
+#ifndef _IPCPOSIX_H_
+#define _IPCPOSIX_H_
+
+// What the POSIX transport and the stand-in sim (IPCsim.c) agree on.
+//
+// The sim owns a small mailbox in shared memory, and three named semaphores. A client makes a shared
+// block of its own for its requests, as it would on Windows. To send, it takes the lock, puts the name
+// of its block and the next request number in the mailbox, posts the request semaphore and waits on the
+// reply semaphore - for no more than the two seconds FSUIPC is given - until the sim has answered that
+// number. The numbers are counted in the mailbox, under the lock, so no two clients ever use the same one.
+// The sim only answers the latest number, so once a client has given up on a request, and another has
+// been put in the mailbox, the one given up on is dropped rather than answered as if it were the new one.
+
+#define FS6IPC_POSIX_NAME     "/FsasmLib.IPC"          // the sim's mailbox
+#define FS6IPC_POSIX_LOCK     "/FsasmLib.IPC.lock"     // held by the client whose request is in the mailbox
+#define FS6IPC_POSIX_REQUEST  "/FsasmLib.IPC.request"  // posted by a client when its request is ready
+#define FS6IPC_POSIX_REPLY    "/FsasmLib.IPC.reply"    // posted by the sim when it's answered one
+
+#define FS6IPC_POSIX_MAGIC    0x46533649               // "FS6I"
+#define FS6IPC_POSIX_TIMEOUT  2000                     // mSecs, as for SendMessageTimeout
+
+typedef struct tagFS6IPC_POSIX_MAILBOX
+{
+  DWORD dwMagic;    // FS6IPC_POSIX_MAGIC, once the sim's ready
+  DWORD dwSeq;      // number of the latest request, counted up by the clients
+  DWORD dwDone;     // number of the request last answered, set by the sim
+  DWORD dwResult;   // FS6IPC_MESSAGE_SUCCESS or FS6IPC_MESSAGE_FAILURE, set by the sim
+  DWORD dwSize;     // size of the client's block
+  char szName[64];  // name of the client's block
+} FS6IPC_POSIX_MAILBOX;
+
+#endif // _IPCPOSIX_H_
@@ -0,0 +1,307 @@
+/* IPCSIM.C	A stand-in sim, serving FS6IPC read and write requests from an offset table
+*******************************************************************************
+
+For running and load testing the library off Windows, through the POSIX transport. It answers requests
+the way FSUIPC does, from a 64K table of offsets, and can be told to fail or ignore a share of them to
+see how the client copes.
+
+	cc -o ipcsim IPCsim.c -lrt -pthread
+
+	ipcsim [-t table] [-f fail%] [-s stall%] [-v]
+
+	-t	offsets to start with, one to a line: the offset and size in hex, then the value
+		(e.g. "034E 2 0x2280"). # starts a comment.
+	-f	answer this percentage of requests with a failure (FSUIPC_ERR_DATA for the client)
+	-s	don't answer this percentage at all (FSUIPC_ERR_TIMEOUT for the client)
+	-v	report how many requests have been served, each second
+
+The version offsets are set up as P3D under FSUIPC 4.999, unless the table says otherwise.
+
+******************************************************************************/
+
+#include "IPCuser.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "IPCposix.h"
+
+#define TABLE_SIZE 0x10000
+#define VERSION_START 0x3304    // FSUIPC version, then the FS version and check pattern
+#define VERSION_END   0x330C
+
+static BYTE    m_table[TABLE_SIZE];
+static volatile sig_atomic_t m_fStop = 0;
+
+static void Sim_Stop(int iSignal)
+{	(void)iSignal;
+	m_fStop = 1;
+}
+
+/******************************************************************************
+			Sim_SetOffset
+******************************************************************************/
+
+static BOOL Sim_SetOffset(DWORD dwOffset, DWORD dwSize, unsigned long long qwValue)
+{	if (dwSize > 8 || dwOffset > TABLE_SIZE - dwSize)
+		return FALSE;
+
+	// Offsets are little endian, as they are on the PC
+	for (DWORD i = 0; i < dwSize; i++)
+		m_table[dwOffset + i] = (BYTE)(qwValue >> (8 * i));
+
+	return TRUE;
+}
+
+/******************************************************************************
+			Sim_LoadTable
+******************************************************************************/
+
+// return: 0 if it's loaded, or the number of the line that couldn't be understood (-1 if it can't be read)
+static int Sim_LoadTable(const char* szPath)
+{	char szLine[256];
+	int iLine = 0;
+	FILE* pFile = fopen(szPath, "r");
+
+	if (!pFile)
+		return -1;
+
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{	unsigned int dwOffset, dwSize;
+		unsigned long long qwValue;
+		char* pComment = strchr(szLine, '#');
+		char szValue[64];
+		int nFields;
+
+		iLine++;
+		if (pComment) *pComment = 0;
+
+		nFields = sscanf(szLine, "%x %x %63s", &dwOffset, &dwSize, szValue);
+		if (nFields <= 0)
+			continue;
+
+		qwValue = strtoull(szValue, NULL, 0);
+		if (nFields != 3 || !Sim_SetOffset(dwOffset, dwSize, qwValue))
+		{	fclose(pFile);
+			return iLine;
+		}
+	}
+
+	fclose(pFile);
+	return 0;
+}
+
+/******************************************************************************
+			Sim_Process
+******************************************************************************/
+
+// Whether a request of this size, with its header, fits in what's left of the block, and what it asks for
+// is in the table. The checks are made so that nothing a client sends can wrap them round.
+#define Sim_Fits(dwLeft, nHdr, nBytes, dwOffset) \
+	((nHdr) <= (dwLeft) && (nBytes) <= (dwLeft) - (nHdr) && (nBytes) <= TABLE_SIZE && (dwOffset) <= TABLE_SIZE - (nBytes))
+
+// Answers the requests in a client's block, in place, as FSUIPC would.
+// return: FS6IPC_MESSAGE_SUCCESS, or FS6IPC_MESSAGE_FAILURE if any request runs off the block or the table
+static DWORD Sim_Process(BYTE* pView, DWORD dwSize, DWORD* pdwRequests)
+{	DWORD dwPos = 0;
+
+	while (sizeof(DWORD) <= dwSize - dwPos)
+	{	DWORD dwId = *(DWORD*)&pView[dwPos];
+
+		if (dwId == 0)
+			return FS6IPC_MESSAGE_SUCCESS;
+
+		if (dwId == FS6IPC_READSTATEDATA_ID)
+		{	FS6IPC_READSTATEDATA_HDR* pHdr = (FS6IPC_READSTATEDATA_HDR*)&pView[dwPos];
+
+			if (!Sim_Fits(dwSize - dwPos, sizeof(*pHdr), pHdr->nBytes, pHdr->dwOffset))
+				return FS6IPC_MESSAGE_FAILURE;
+
+			CopyMemory(&pView[dwPos + sizeof(*pHdr)], &m_table[pHdr->dwOffset], pHdr->nBytes);
+			dwPos += sizeof(*pHdr) + pHdr->nBytes;
+		}
+		else if (dwId == FS6IPC_WRITESTATEDATA_ID)
+		{	FS6IPC_WRITESTATEDATA_HDR* pHdr = (FS6IPC_WRITESTATEDATA_HDR*)&pView[dwPos];
+
+			if (!Sim_Fits(dwSize - dwPos, sizeof(*pHdr), pHdr->nBytes, pHdr->dwOffset))
+				return FS6IPC_MESSAGE_FAILURE;
+
+			// The version offsets are read only. FSUIPC only logs the library version written over
+			// them, and keeping it would spoil the check pattern for the next client to open.
+			if (pHdr->dwOffset >= VERSION_END || pHdr->dwOffset + pHdr->nBytes <= VERSION_START)
+				CopyMemory(&m_table[pHdr->dwOffset], &pView[dwPos + sizeof(*pHdr)], pHdr->nBytes);
+			dwPos += sizeof(*pHdr) + pHdr->nBytes;
+		}
+		else
+		{	return FS6IPC_MESSAGE_FAILURE;
+		}
+
+		(*pdwRequests)++;
+	}
+
+	return FS6IPC_MESSAGE_FAILURE; // No terminator
+}
+
+/******************************************************************************
+			main
+******************************************************************************/
+
+int main(int argc, char** argv)
+{	FS6IPC_POSIX_MAILBOX* pMailbox;
+	sem_t *pLock, *pRequest, *pReply;
+	char szClient[64] = "";
+	BYTE* pClient = 0;
+	DWORD dwClientSize = 0;
+	int iFail = 0, iStall = 0, fVerbose = 0;
+	unsigned long nServed = 0, nFailed = 0, nStalled = 0, nDropped = 0;
+	DWORD dwRequests = 0;
+	time_t tReport = time(NULL);
+	int fd, i;
+
+	// P3D (10), under FSUIPC 4.999, with the check pattern
+	Sim_SetOffset(0x3304, 4, 0x49990000);
+	Sim_SetOffset(0x3308, 4, 0xFADE000A);
+
+	for (i = 1; i < argc; i++)
+	{	if (!strcmp(argv[i], "-t") && i + 1 < argc)
+		{	int iLine = Sim_LoadTable(argv[++i]);
+			if (iLine != 0)
+			{	fprintf(stderr, iLine < 0 ? "Can't read %s\n" : "Problem in %s on line %d\n", argv[i], iLine);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+			iFail = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			iStall = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-v"))
+			fVerbose = 1;
+		else
+		{	fprintf(stderr, "usage: %s [-t table] [-f fail%%] [-s stall%%] [-v]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Start from nothing, in case a previous run didn't get to tidy up
+	shm_unlink(FS6IPC_POSIX_NAME);
+	sem_unlink(FS6IPC_POSIX_LOCK);
+	sem_unlink(FS6IPC_POSIX_REQUEST);
+	sem_unlink(FS6IPC_POSIX_REPLY);
+
+	fd = shm_open(FS6IPC_POSIX_NAME, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0 || ftruncate(fd, sizeof(FS6IPC_POSIX_MAILBOX)) != 0)
+	{	perror("mailbox");
+		return 1;
+	}
+
+	pMailbox = (FS6IPC_POSIX_MAILBOX*)mmap(NULL, sizeof(FS6IPC_POSIX_MAILBOX), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	pLock = sem_open(FS6IPC_POSIX_LOCK, O_CREAT | O_EXCL, 0600, 1);
+	pRequest = sem_open(FS6IPC_POSIX_REQUEST, O_CREAT | O_EXCL, 0600, 0);
+	pReply = sem_open(FS6IPC_POSIX_REPLY, O_CREAT | O_EXCL, 0600, 0);
+	if (pMailbox == MAP_FAILED || pLock == SEM_FAILED || pRequest == SEM_FAILED || pReply == SEM_FAILED)
+	{	perror("semaphores");
+		return 1;
+	}
+
+	signal(SIGINT, Sim_Stop);
+	signal(SIGTERM, Sim_Stop);
+
+	// Clients only believe we're here once this is set
+	pMailbox->dwMagic = FS6IPC_POSIX_MAGIC;
+
+	while (!m_fStop)
+	{	struct timespec deadline;
+		DWORD dwResult;
+		DWORD dwSeq;
+
+		if (fVerbose && time(NULL) != tReport)
+		{	tReport = time(NULL);
+			printf("%lu served (%lu requests), %lu failed, %lu stalled, %lu dropped\n", nServed, (unsigned long)dwRequests, nFailed, nStalled, nDropped);
+			fflush(stdout);
+		}
+
+		// Wake now and again to see if we've been stopped
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec++;
+		if (sem_timedwait(pRequest, &deadline) != 0)
+			continue;
+
+		// Only the latest request is answered, and only once. Any other was given up on, and its
+		// client may have put another in the mailbox since.
+		dwSeq = pMailbox->dwSeq;
+		if (dwSeq == pMailbox->dwDone)
+		{	nDropped++;
+			continue;
+		}
+
+		// A new client, or the same one reopened, means a new block to look at
+		if (strncmp(szClient, pMailbox->szName, sizeof(szClient)) != 0 || dwClientSize != pMailbox->dwSize)
+		{	if (pClient)
+			{	munmap(pClient, dwClientSize);
+				pClient = 0;
+			}
+
+			memcpy(szClient, pMailbox->szName, sizeof(szClient));
+			szClient[sizeof(szClient) - 1] = 0;
+			dwClientSize = pMailbox->dwSize;
+
+			fd = shm_open(szClient, O_RDWR, 0);
+			if (fd >= 0)
+			{	void* pView = mmap(NULL, dwClientSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				pClient = (pView == MAP_FAILED) ? 0 : (BYTE*)pView;
+				close(fd);
+			}
+		}
+
+		if (iStall > 0 && rand() % 100 < iStall)
+		{	nStalled++;
+			continue;
+		}
+
+		if (!pClient)
+			dwResult = FS6IPC_MESSAGE_FAILURE;
+		else if (iFail > 0 && rand() % 100 < iFail)
+			dwResult = FS6IPC_MESSAGE_FAILURE;
+		else
+			dwResult = Sim_Process(pClient, dwClientSize, &dwRequests);
+
+		// Given up on while it was being answered, so there's no one to tell
+		if (pMailbox->dwSeq != dwSeq)
+		{	nDropped++;
+			continue;
+		}
+
+		if (dwResult == FS6IPC_MESSAGE_SUCCESS)
+			nServed++;
+		else
+			nFailed++;
+
+		pMailbox->dwResult = dwResult;
+		pMailbox->dwDone = dwSeq;
+		sem_post(pReply);
+	}
+
+	pMailbox->dwMagic = 0;
+
+	if (pClient)
+		munmap(pClient, dwClientSize);
+
+	shm_unlink(FS6IPC_POSIX_NAME);
+	sem_unlink(FS6IPC_POSIX_LOCK);
+	sem_unlink(FS6IPC_POSIX_REQUEST);
+	sem_unlink(FS6IPC_POSIX_REPLY);
+
+	return 0;
+}
+
+/******************************************************************************
+ End of IPCsim module
+******************************************************************************/
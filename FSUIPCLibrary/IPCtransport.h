@@ -0,0 +1,45 @@
+#ifndef _IPCTRANSPORT_H_
+#define _IPCTRANSPORT_H_
+
+// How the requests IPCuser builds get to the sim and the answers get back.
+//
+// The transport provides a block of memory the sim can see. IPCuser writes its read and write requests
+// into it, asks the transport to send them, and then finds the answers written over the requests, just
+// as FS6IPC has always done. On Windows that's a file mapping named to FSUIPC through a global atom and
+// a window message; elsewhere it's POSIX shared memory and semaphores, served by a stand-in sim.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tagIPC_TRANSPORT
+{
+	const char* szName;
+
+	// Finds the sim and makes a shared block of at least dwSize bytes.
+	// return: the block if successful, or NULL with the reason in *pdwResult.
+	// *pfWideFS is set if it's only found something pretending to be FS98, like WideClient.
+	BYTE* (*pfnOpen)(DWORD dwSize, BOOL *pfWideFS, DWORD *pdwResult);
+
+	// Has the sim act on the requests in the block, waiting for it to finish.
+	// return: TRUE if successful, FALSE otherwise (FSUIPC_ERR_TIMEOUT, FSUIPC_ERR_SENDMSG or FSUIPC_ERR_DATA).
+	BOOL (*pfnSend)(DWORD *pdwResult);
+
+	// Lets go of the block and the sim. There's no harm in calling it when it isn't open.
+	void (*pfnClose)(void);
+} IPC_TRANSPORT;
+
+#ifdef _WIN32
+extern const IPC_TRANSPORT IPC_Win32Transport;
+#else
+extern const IPC_TRANSPORT IPC_PosixTransport;
+#endif
+
+// Changes the transport used from the next FSUIPC_Open. NULL goes back to the one for the platform.
+extern void FSUIPC_SetTransport(const IPC_TRANSPORT *pTransport);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // _IPCTRANSPORT_H_
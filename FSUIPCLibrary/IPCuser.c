@@ -21,11 +21,15 @@ DWORD FSUIPC_Version = 0;
 DWORD FSUIPC_FS_Version = 0;
 DWORD FSUIPC_Lib_Version = LIB_VERSION;
 
-static HWND    m_hWnd = 0;       // FS6 window handle
-static UINT    m_msg = 0;        // id of registered window message
-static ATOM    m_atom = 0;       // global atom containing name of file-mapping object
-static HANDLE  m_hMap = 0;       // handle of file-mapping object
-static BYTE*   m_pView = 0;      // pointer to view of file-mapping object
+#ifdef _WIN32
+#define DEFAULT_TRANSPORT (&IPC_Win32Transport)
+#else
+#define DEFAULT_TRANSPORT (&IPC_PosixTransport)
+#endif
+
+static const IPC_TRANSPORT* m_pTransport = DEFAULT_TRANSPORT; // how requests reach the sim
+static const IPC_TRANSPORT* m_pOpened = 0;                    // the transport the view came from
+static BYTE*   m_pView = 0;      // pointer to view of the shared block
 static BYTE*   m_pNext = 0;
 
 /******************************************************************************
@@ -35,29 +39,35 @@ static BYTE*   m_pNext = 0;
 static int iIndex = 0;
 static void* pDestArray[MAX_MSGS];
 
+// Where each read's answer is in the shared block after the last process,
+// until the next read or write is asked for
+static int iReplies = 0;
+static const BYTE* pReplyArray[MAX_MSGS];
+static DWORD dwReplySizeArray[MAX_MSGS];
+
+/******************************************************************************
+			FSUIPC_SetTransport
+******************************************************************************/
+
+// Choose how to reach the sim from the next open
+void FSUIPC_SetTransport(const IPC_TRANSPORT *pTransport)
+{	m_pTransport = pTransport ? pTransport : DEFAULT_TRANSPORT;
+}
+
 /******************************************************************************
 			FSUIPC_Close
 ******************************************************************************/
 
 // Stop the client
 void FSUIPC_Close(void)
-{	m_hWnd = 0;
-	m_msg = 0;
-  
-	if (m_atom)
-	{	GlobalDeleteAtom(m_atom);
-		m_atom = 0;
+{	if (m_pOpened)
+	{	m_pOpened->pfnClose();
+		m_pOpened = 0;
 	}
 
-	if (m_pView)
-	{	UnmapViewOfFile((LPVOID)m_pView);
-		m_pView = 0;
-	}
-
-	if (m_hMap)
-	{	CloseHandle(m_hMap);
-		m_hMap = 0;
-	}
+	m_pView = 0;
+	m_pNext = 0;
+	iReplies = 0;
 }
 
 /******************************************************************************
@@ -67,9 +77,7 @@ void FSUIPC_Close(void)
 // Start the client
 // return: TRUE if successful, FALSE otherwise
 BOOL FSUIPC_Open(DWORD dwFSReq, DWORD *pdwResult)
-{  char szName[MAX_PATH];
-	static int nTry = 0;
-	BOOL fWideFS = FALSE;
+{	BOOL fWideFS = FALSE;
 	int i = 0;
 	
 	// abort if already started
@@ -81,58 +89,11 @@ BOOL FSUIPC_Open(DWORD dwFSReq, DWORD *pdwResult)
 	// Clear version information, so know when connected
 	FSUIPC_Version = FSUIPC_FS_Version = 0;
 	
-	// Connect via FSUIPC, which is known to be FSUIPC's own
-	// and isn't subject to user modificiation
-	m_hWnd = FindWindowEx(NULL, NULL, "UIPCMAIN", NULL);
-	if (!m_hWnd)
-	{	// If there's no UIPCMAIN, we may be using WideClient
-		// which only simulates FS98
-		m_hWnd = FindWindowEx(NULL, NULL, "FS98MAIN", NULL);
-		fWideFS = TRUE;
-		if (!m_hWnd)
-		{	*pdwResult = FSUIPC_ERR_NOFS;
-			return FALSE;
-		}
-	}
-	
-	// register the window message
-	m_msg = RegisterWindowMessage(FS6IPC_MSGNAME1);
-	if (m_msg == 0)
-	{	*pdwResult = FSUIPC_ERR_REGMSG;
-		return FALSE;
-	}
-
-	// create the name of our file-mapping object
-	nTry++; // Ensures a unique string is used in case user closes and reopens
-	wsprintf(szName, FS6IPC_MSGNAME1 ":%X:%X", GetCurrentProcessId(), nTry);
-
-	// stuff the name into a global atom
-	m_atom = GlobalAddAtom(szName);
-	if (m_atom == 0)
-   {	*pdwResult = FSUIPC_ERR_ATOM;
-		FSUIPC_Close();
-		return FALSE;
-	}
-
-	// create the file-mapping object
-	m_hMap = CreateFileMapping(
-					(HANDLE)-1, 		// use system paging file
-					NULL,               // security
-					PAGE_READWRITE,     // protection
-					0, MAX_SIZE+256,       // size
-					szName);            // name 
-
-	if ((m_hMap == 0) || (GetLastError() == ERROR_ALREADY_EXISTS))
-	{	*pdwResult = FSUIPC_ERR_MAP;
-		FSUIPC_Close();
-		return FALSE;    
-	}
-
-	// get a view of the file-mapping object
-	m_pView = (BYTE*)MapViewOfFile(m_hMap, FILE_MAP_WRITE, 0, 0, 0);
+	// Find the sim and get a view of the block it'll share with us
+	m_pOpened = m_pTransport;
+	m_pView = m_pOpened->pfnOpen(MAX_SIZE+256, &fWideFS, pdwResult);
 	if (m_pView == NULL)
-	{	*pdwResult = FSUIPC_ERR_VIEW;
-		FSUIPC_Close();
+	{	FSUIPC_Close();
 		return FALSE;
 	}
 
@@ -200,12 +161,9 @@ BOOL FSUIPC_Open(DWORD dwFSReq, DWORD *pdwResult)
 ******************************************************************************/
 
 BOOL FSUIPC_Process(DWORD *pdwResult)
-{	DWORD dwError;
-	DWORD_PTR pdwError = (DWORD_PTR)&dwError;
-	DWORD *pdw;
+{	DWORD *pdw;
 	FS6IPC_READSTATEDATA_HDR *pHdrR;
 	FS6IPC_WRITESTATEDATA_HDR *pHdrW;
-	int i = 0;
 	
 	if (!m_pView)
 	{	*pdwResult = FSUIPC_ERR_NOTOPEN;
@@ -219,28 +177,11 @@ BOOL FSUIPC_Process(DWORD *pdwResult)
 
 	ZeroMemory(m_pNext, 4); // Terminator
 	m_pNext = m_pView;
+	iReplies = 0;
 	
-	// send the request (allow up to 9 tries)
-	while ((++i < 10) && !SendMessageTimeout(
-			m_hWnd,       // FS6 window handle
-			m_msg,        // our registered message id
-			m_atom,       // wParam: name of file-mapping object
-			0,            // lParam: offset of request into file-mapping obj
-			SMTO_BLOCK,   // halt this thread until we get a response
-			2000,			 // time out interval
-			&pdwError))    // return value
-	{	Sleep(100); // Allow for things to happen
-	}
-
-	if (i >= 10) // Failed all tries?
-	{	*pdwResult = GetLastError() == 0 ? FSUIPC_ERR_TIMEOUT : FSUIPC_ERR_SENDMSG;
-		return FALSE;
-	}
-
-	if (pdwError != FS6IPC_MESSAGE_SUCCESS)
-	{	*pdwResult = FSUIPC_ERR_DATA; // FSUIPC didn't like something in the data!
+	// send the request, and wait for the answers
+	if (!m_pOpened->pfnSend(pdwResult))
 		return FALSE;
-	}
 
 	// Decode and store results of Read requests
 	pdw = (DWORD *) m_pView;
@@ -250,6 +191,10 @@ BOOL FSUIPC_Process(DWORD *pdwResult)
 		{	case FS6IPC_READSTATEDATA_ID:
 				pHdrR = (FS6IPC_READSTATEDATA_HDR *) pdw;
 				m_pNext += sizeof(FS6IPC_READSTATEDATA_HDR);
+				if (pHdrR->iDest < MAX_MSGS)
+				{	pReplyArray[pHdrR->iDest] = m_pNext;
+					dwReplySizeArray[pHdrR->iDest] = pHdrR->nBytes;
+				}
 				if (pDestArray[pHdrR->iDest] && pHdrR->nBytes)
 					CopyMemory(pDestArray[pHdrR->iDest], m_pNext, pHdrR->nBytes);
 				m_pNext += pHdrR->nBytes;
@@ -271,11 +216,30 @@ BOOL FSUIPC_Process(DWORD *pdwResult)
 	}
 
 	m_pNext = m_pView;
+	iReplies = iIndex;
     iIndex = 0;
 	*pdwResult = FSUIPC_ERR_OK;
 	return TRUE;
 }
 
+/******************************************************************************
+			FSUIPC_Reply
+******************************************************************************/
+
+// The answer to a read, where it is in the shared block, so it can be used
+// without being copied out. Reads are numbered from 0 in the order they were
+// asked for since the last process. Only good until the next read or write
+// is asked for, as that reuses the block; NULL if there's no such answer.
+const BYTE *FSUIPC_Reply(DWORD iRead, DWORD *pdwSize)
+{	if (!m_pView || m_pNext != m_pView || iRead >= (DWORD) iReplies)
+	{	if (pdwSize) *pdwSize = 0;
+		return NULL;
+	}
+
+	if (pdwSize) *pdwSize = dwReplySizeArray[iRead];
+	return pReplyArray[iRead];
+}
+
 /******************************************************************************
 			FSUIPC_Read
 ******************************************************************************/
@@ -302,7 +266,8 @@ BOOL FSUIPC_Read(DWORD dwOffset, DWORD dwSize, void *pDest, DWORD *pdwResult)
 	pHdr->nBytes = dwSize;
     pHdr->iDest = iIndex;
 
-    // Save the destination data pointer into the array for later
+    // Save the destination data pointer into the array for later. With no
+    // destination the answer is left where it is, for FSUIPC_Reply
     pDestArray[iIndex++] = pDest;
 
 	// Zero the reception area, so rubbish won't be returned
@@ -1,6 +1,28 @@
+#ifdef _WIN32
 #include <windows.h>
+#else
+// Enough of the Windows types for the library to build elsewhere, talking through the POSIX transport.
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef uint32_t DWORD;
+typedef uint16_t WORD;
+typedef uint8_t BYTE;
+typedef int BOOL;
+typedef uintptr_t DWORD_PTR;
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+
+#define ZeroMemory(pDest, dwSize) memset((pDest), 0, (dwSize))
+#define CopyMemory(pDest, pSrce, dwSize) memcpy((pDest), (pSrce), (dwSize))
+#define Sleep(dwMilliseconds) usleep((dwMilliseconds) * 1000)
+#endif
 
 #include "FSUIPC_User.h"
+#include "IPCtransport.h"
 
 #define FS6IPC_MSGNAME1      "FsasmLib:IPC" 
 
@@ -0,0 +1,148 @@
+/* IPCWIN32.C	The Windows transport for IPCuser - a file mapping named through a global atom and a window message
+******************************************************************************/
+
+#include "IPCuser.h"
+
+#ifdef _WIN32
+
+static HWND    m_hWnd = 0;       // FS6 window handle
+static UINT    m_msg = 0;        // id of registered window message
+static ATOM    m_atom = 0;       // global atom containing name of file-mapping object
+static HANDLE  m_hMap = 0;       // handle of file-mapping object
+static BYTE*   m_pView = 0;      // pointer to view of file-mapping object
+
+/******************************************************************************
+			Win32_Close
+******************************************************************************/
+
+static void Win32_Close(void)
+{	m_hWnd = 0;
+	m_msg = 0;
+  
+	if (m_atom)
+	{	GlobalDeleteAtom(m_atom);
+		m_atom = 0;
+	}
+
+	if (m_pView)
+	{	UnmapViewOfFile((LPVOID)m_pView);
+		m_pView = 0;
+	}
+
+	if (m_hMap)
+	{	CloseHandle(m_hMap);
+		m_hMap = 0;
+	}
+}
+
+/******************************************************************************
+			Win32_Open
+******************************************************************************/
+
+static BYTE* Win32_Open(DWORD dwSize, BOOL *pfWideFS, DWORD *pdwResult)
+{	char szName[MAX_PATH];
+	static int nTry = 0;
+
+	*pfWideFS = FALSE;
+
+	// Connect via FSUIPC, which is known to be FSUIPC's own
+	// and isn't subject to user modificiation
+	m_hWnd = FindWindowEx(NULL, NULL, "UIPCMAIN", NULL);
+	if (!m_hWnd)
+	{	// If there's no UIPCMAIN, we may be using WideClient
+		// which only simulates FS98
+		m_hWnd = FindWindowEx(NULL, NULL, "FS98MAIN", NULL);
+		*pfWideFS = TRUE;
+		if (!m_hWnd)
+		{	*pdwResult = FSUIPC_ERR_NOFS;
+			return NULL;
+		}
+	}
+	
+	// register the window message
+	m_msg = RegisterWindowMessage(FS6IPC_MSGNAME1);
+	if (m_msg == 0)
+	{	*pdwResult = FSUIPC_ERR_REGMSG;
+		return NULL;
+	}
+
+	// create the name of our file-mapping object
+	nTry++; // Ensures a unique string is used in case user closes and reopens
+	wsprintf(szName, FS6IPC_MSGNAME1 ":%X:%X", GetCurrentProcessId(), nTry);
+
+	// stuff the name into a global atom
+	m_atom = GlobalAddAtom(szName);
+	if (m_atom == 0)
+	{	*pdwResult = FSUIPC_ERR_ATOM;
+		Win32_Close();
+		return NULL;
+	}
+
+	// create the file-mapping object
+	m_hMap = CreateFileMapping(
+					(HANDLE)-1, 		// use system paging file
+					NULL,               // security
+					PAGE_READWRITE,     // protection
+					0, dwSize,          // size
+					szName);            // name 
+
+	if ((m_hMap == 0) || (GetLastError() == ERROR_ALREADY_EXISTS))
+	{	*pdwResult = FSUIPC_ERR_MAP;
+		Win32_Close();
+		return NULL;    
+	}
+
+	// get a view of the file-mapping object
+	m_pView = (BYTE*)MapViewOfFile(m_hMap, FILE_MAP_WRITE, 0, 0, 0);
+	if (m_pView == NULL)
+	{	*pdwResult = FSUIPC_ERR_VIEW;
+		Win32_Close();
+		return NULL;
+	}
+
+	*pdwResult = FSUIPC_ERR_OK;
+	return m_pView;
+}
+
+/******************************************************************************
+			Win32_Send
+******************************************************************************/
+
+static BOOL Win32_Send(DWORD *pdwResult)
+{	DWORD dwError;
+	DWORD_PTR pdwError = (DWORD_PTR)&dwError;
+	int i = 0;
+
+	// send the request (allow up to 9 tries)
+	while ((++i < 10) && !SendMessageTimeout(
+			m_hWnd,       // FS6 window handle
+			m_msg,        // our registered message id
+			m_atom,       // wParam: name of file-mapping object
+			0,            // lParam: offset of request into file-mapping obj
+			SMTO_BLOCK,   // halt this thread until we get a response
+			2000,			 // time out interval
+			&pdwError))    // return value
+	{	Sleep(100); // Allow for things to happen
+	}
+
+	if (i >= 10) // Failed all tries?
+	{	*pdwResult = GetLastError() == 0 ? FSUIPC_ERR_TIMEOUT : FSUIPC_ERR_SENDMSG;
+		return FALSE;
+	}
+
+	if (pdwError != FS6IPC_MESSAGE_SUCCESS)
+	{	*pdwResult = FSUIPC_ERR_DATA; // FSUIPC didn't like something in the data!
+		return FALSE;
+	}
+
+	*pdwResult = FSUIPC_ERR_OK;
+	return TRUE;
+}
+
+const IPC_TRANSPORT IPC_Win32Transport = { "Win32", Win32_Open, Win32_Send, Win32_Close };
+
+#endif
+
+/******************************************************************************
+ End of IPCwin32 module
+******************************************************************************/
@@ -0,0 +1,353 @@
+/* XPLANESIM.C	A stand-in X-Plane, sending datarefs over UDP to whoever asks for them
+*******************************************************************************
+
+For running and load testing the plugin's X-Plane source without X-Plane, as IPCsim.c is for FSUIPC. It
+listens for RREF requests as X-Plane does, and sends each dataref asked for back to the socket that asked,
+at the rate asked for, until it's asked for at a rate of 0. Values come from a table - anything it's asked
+for that isn't in it is sent as 0, as X-Plane does for datarefs it doesn't know.
+
+	cc -o xplanesim XPlaneSim.c
+
+	xplanesim [-p port] [-t table] [-v]
+
+	-p	port to listen on (49000, as X-Plane)
+	-t	values to start with, one to a line: the dataref, then the value
+		(e.g. "sim/flightmodel/position/latitude 51.47"). # starts a comment.
+	-v	report how many datarefs are being sent, and how many datagrams have gone, each second
+
+The radios and position are set up as tuned to 122.800 on com1 at Heathrow, unless the table says otherwise.
+
+******************************************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PATH_SIZE     400    // as in an RREF request
+#define REQUEST_SIZE  (5 + 4 + 4 + PATH_SIZE)
+#define MAX_VALUES    256
+#define MAX_REFS      256    // subscriptions, across every client
+#define MAX_PAIRS     128    // index and value pairs in a datagram
+
+typedef struct tagSIM_VALUE
+{
+	char szPath[PATH_SIZE];
+	float fValue;
+} SIM_VALUE;
+
+typedef struct tagSIM_REF
+{
+	struct sockaddr_in addr;  // where to send it
+	int32_t iIndex;           // what to send it back as
+	int32_t iRate;            // times a second
+	double dNext;             // when it's next due
+	char szPath[PATH_SIZE];
+} SIM_REF;
+
+static SIM_VALUE m_values[MAX_VALUES];
+static int       m_nValues = 0;
+static SIM_REF   m_refs[MAX_REFS];
+static int       m_nRefs = 0;
+static volatile sig_atomic_t m_fStop = 0;
+
+static void Sim_Stop(int iSignal)
+{	(void)iSignal;
+	m_fStop = 1;
+}
+
+static double Sim_Now(void)
+{	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/******************************************************************************
+			Sim_SetValue
+******************************************************************************/
+
+static int Sim_SetValue(const char* szPath, float fValue)
+{	int i;
+
+	for (i = 0; i < m_nValues; i++)
+	{	if (!strcmp(m_values[i].szPath, szPath))
+		{	m_values[i].fValue = fValue;
+			return 1;
+		}
+	}
+
+	if (m_nValues == MAX_VALUES || strlen(szPath) >= PATH_SIZE)
+		return 0;
+
+	strcpy(m_values[m_nValues].szPath, szPath);
+	m_values[m_nValues].fValue = fValue;
+	m_nValues++;
+
+	return 1;
+}
+
+static float Sim_GetValue(const char* szPath)
+{	int i;
+
+	for (i = 0; i < m_nValues; i++)
+	{	if (!strcmp(m_values[i].szPath, szPath))
+			return m_values[i].fValue;
+	}
+
+	return 0.0f;
+}
+
+/******************************************************************************
+			Sim_LoadTable
+******************************************************************************/
+
+// return: 0 if it's loaded, or the number of the line that couldn't be understood (-1 if it can't be read)
+static int Sim_LoadTable(const char* szPath)
+{	char szLine[512];
+	int iLine = 0;
+	FILE* pFile = fopen(szPath, "r");
+
+	if (!pFile)
+		return -1;
+
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{	char szRef[PATH_SIZE];
+		char* pComment = strchr(szLine, '#');
+		float fValue;
+		int nFields;
+
+		iLine++;
+		if (pComment) *pComment = 0;
+
+		nFields = sscanf(szLine, "%399s %f", szRef, &fValue);
+		if (nFields <= 0)
+			continue;
+
+		if (nFields != 2 || !Sim_SetValue(szRef, fValue))
+		{	fclose(pFile);
+			return iLine;
+		}
+	}
+
+	fclose(pFile);
+	return 0;
+}
+
+/******************************************************************************
+			Sim_Subscribe
+******************************************************************************/
+
+// Takes an RREF request: a new subscription, a change of rate or dataref for one already there, or at a
+// rate of 0, an end to it. Each client numbers its own, so they're told apart by where they came from.
+// return: 0 if it wasn't an RREF request, or there's no room for another subscription
+static int Sim_Subscribe(const char* pRequest, int nLength, const struct sockaddr_in* pFrom)
+{	int32_t iRate, iIndex;
+	char szPath[PATH_SIZE];
+	int i;
+
+	if (nLength < REQUEST_SIZE || memcmp(pRequest, "RREF", 4) != 0)
+		return 0;
+
+	memcpy(&iRate, pRequest + 5, 4);
+	memcpy(&iIndex, pRequest + 9, 4);
+	memcpy(szPath, pRequest + 13, PATH_SIZE);
+	szPath[PATH_SIZE - 1] = 0;
+
+	for (i = 0; i < m_nRefs; i++)
+	{	if (m_refs[i].iIndex == iIndex && m_refs[i].addr.sin_addr.s_addr == pFrom->sin_addr.s_addr && m_refs[i].addr.sin_port == pFrom->sin_port)
+			break;
+	}
+
+	if (iRate <= 0)
+	{	if (i < m_nRefs)
+			m_refs[i] = m_refs[--m_nRefs];
+
+		return 1;
+	}
+
+	if (i == m_nRefs)
+	{	if (m_nRefs == MAX_REFS)
+			return 0;
+
+		m_nRefs++;
+	}
+
+	m_refs[i].addr = *pFrom;
+	m_refs[i].iIndex = iIndex;
+	m_refs[i].iRate = iRate;
+	m_refs[i].dNext = Sim_Now();
+	strcpy(m_refs[i].szPath, szPath);
+
+	return 1;
+}
+
+/******************************************************************************
+			Sim_SendDue
+******************************************************************************/
+
+// Sends everything that's due, each client's in as few datagrams as it takes, as X-Plane does.
+// return: how many datagrams were sent
+static unsigned long Sim_SendDue(int s, double dNow)
+{	char datagram[5 + 8 * MAX_PAIRS];
+	char fSent[MAX_REFS];
+	unsigned long nSent = 0;
+	int i, j;
+
+	memset(fSent, 0, sizeof(fSent));
+
+	for (i = 0; i < m_nRefs; i++)
+	{	int nPairs = 0;
+
+		if (fSent[i] || m_refs[i].dNext > dNow)
+			continue;
+
+		memcpy(datagram, "RREF,", 5);
+
+		// This one, and anything else due to the same client
+		for (j = i; j < m_nRefs && nPairs < MAX_PAIRS; j++)
+		{	float fValue;
+
+			if (fSent[j] || m_refs[j].dNext > dNow)
+				continue;
+
+			if (m_refs[j].addr.sin_addr.s_addr != m_refs[i].addr.sin_addr.s_addr || m_refs[j].addr.sin_port != m_refs[i].addr.sin_port)
+				continue;
+
+			fValue = Sim_GetValue(m_refs[j].szPath);
+			memcpy(datagram + 5 + 8 * nPairs, &m_refs[j].iIndex, 4);
+			memcpy(datagram + 5 + 8 * nPairs + 4, &fValue, 4);
+			nPairs++;
+
+			fSent[j] = 1;
+
+			// Kept to the rate, but without trying to catch up after a stall
+			m_refs[j].dNext += 1.0 / m_refs[j].iRate;
+			if (m_refs[j].dNext < dNow)
+				m_refs[j].dNext = dNow + 1.0 / m_refs[j].iRate;
+		}
+
+		sendto(s, datagram, 5 + 8 * nPairs, 0, (const struct sockaddr*)&m_refs[i].addr, sizeof(m_refs[i].addr));
+		nSent++;
+	}
+
+	return nSent;
+}
+
+/******************************************************************************
+			main
+******************************************************************************/
+
+int main(int argc, char** argv)
+{	struct sockaddr_in addr;
+	int iPort = 49000, fVerbose = 0;
+	unsigned long nSent = 0, nRefused = 0;
+	time_t tReport = time(NULL);
+	int s, i;
+
+	// 122.800 on com1 (selection 6), at Heathrow, on the ground
+	Sim_SetValue("sim/cockpit2/radios/actuators/com1_frequency_hz_833", 122800);
+	Sim_SetValue("sim/cockpit2/radios/actuators/com1_standby_frequency_hz_833", 121500);
+	Sim_SetValue("sim/cockpit2/radios/actuators/com2_frequency_hz_833", 118500);
+	Sim_SetValue("sim/cockpit2/radios/actuators/com2_standby_frequency_hz_833", 121900);
+	Sim_SetValue("sim/cockpit2/radios/actuators/audio_com_selection", 6);
+	Sim_SetValue("sim/flightmodel/position/latitude", 51.4775f);
+	Sim_SetValue("sim/flightmodel/position/longitude", -0.4614f);
+	Sim_SetValue("sim/flightmodel/failures/onground_any", 1);
+
+	for (i = 1; i < argc; i++)
+	{	if (!strcmp(argv[i], "-t") && i + 1 < argc)
+		{	int iLine = Sim_LoadTable(argv[++i]);
+			if (iLine != 0)
+			{	fprintf(stderr, iLine < 0 ? "Can't read %s\n" : "Problem in %s on line %d\n", argv[i], iLine);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+			iPort = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-v"))
+			fVerbose = 1;
+		else
+		{	fprintf(stderr, "usage: %s [-p port] [-t table] [-v]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s < 0)
+	{	perror("socket");
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)iPort);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(s, (const struct sockaddr*)&addr, sizeof(addr)) != 0)
+	{	perror("bind");
+		return 1;
+	}
+
+	signal(SIGINT, Sim_Stop);
+	signal(SIGTERM, Sim_Stop);
+
+	while (!m_fStop)
+	{	double dNow = Sim_Now();
+		double dNext = dNow + 1.0;  // wake now and again to see if we've been stopped
+		struct timeval tv;
+		fd_set readable;
+
+		if (fVerbose && time(NULL) != tReport)
+		{	tReport = time(NULL);
+			printf("%d datarefs sent, %lu datagrams, %lu requests refused\n", m_nRefs, nSent, nRefused);
+			fflush(stdout);
+		}
+
+		nSent += Sim_SendDue(s, dNow);
+
+		for (i = 0; i < m_nRefs; i++)
+		{	if (m_refs[i].dNext < dNext)
+				dNext = m_refs[i].dNext;
+		}
+
+		if (dNext < dNow)
+			dNext = dNow;
+
+		tv.tv_sec = (long)(dNext - dNow);
+		tv.tv_usec = (long)((dNext - dNow - tv.tv_sec) * 1e6);
+
+		FD_ZERO(&readable);
+		FD_SET(s, &readable);
+		if (select(s + 1, &readable, NULL, NULL, &tv) <= 0)
+			continue;
+
+		// Everything that's waiting, so a burst of requests is taken in one go
+		for (;;)
+		{	char request[REQUEST_SIZE + 1];
+			struct sockaddr_in from;
+			socklen_t fromLength = sizeof(from);
+			int nLength = (int)recvfrom(s, request, sizeof(request), MSG_DONTWAIT, (struct sockaddr*)&from, &fromLength);
+
+			if (nLength < 0)
+				break;
+
+			if (!Sim_Subscribe(request, nLength, &from))
+				nRefused++;
+		}
+	}
+
+	close(s);
+
+	return 0;
+}
+
+/******************************************************************************
+ End of XPlaneSim module
+******************************************************************************/